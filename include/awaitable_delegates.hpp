@@ -0,0 +1,229 @@
+#pragma once
+#ifndef __CREAKY_AWAITABLE_DELEGATES_T_H__
+#define __CREAKY_AWAITABLE_DELEGATES_T_H__
+
+#include "delegates.hpp"
+
+// only with compilers implementing C++20 coroutines
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define YAGLIB_DELEGATES_HAS_COROUTINES
+
+#include <coroutine>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace creaky
+{
+
+    namespace details
+    {
+        // what co_await next() gives back: nothing, the argument, or a tuple of them
+        template<typename... Args>
+        struct await_result { typedef std::tuple<typename std::decay<Args>::type...> type; };
+
+        template<>
+        struct await_result<> { typedef void type; };
+
+        template<typename T>
+        struct await_result<T> { typedef typename std::decay<T>::type type; };
+
+    } /// namespace details
+
+
+    /**
+     * awaitable_delegates
+     * -------------------
+     *
+     * basic_delegates that coroutines can wait on:
+     *
+     *    auto [x, y] = co_await clicked.next();
+     *
+     * suspends the coroutine until the next call, and resumes it from inside
+     * that call, after the handlers, with a copy of the arguments (the
+     * argument itself when there is only one, nothing when there is none).
+     *
+     * the awaiter returned by next() is the waiter node: it lives in the
+     * coroutine frame and is linked into the list directly, so waiting never
+     * allocates.  a call takes the whole list at once and wakes the waiters
+     * in the order they started waiting; a coroutine that waits again once
+     * resumed waits for the call after.  a coroutine destroyed while waiting
+     * unlinks itself.  if a resumed coroutine throws, the waiters not woken
+     * yet go back to the list, ahead of the others, and wait for the next
+     * call.  the container must outlive its waiters.
+     *
+     */
+    template<typename... Args>
+    class awaitable_delegates : basic_delegates<Args...>
+    {
+        typedef basic_delegates<Args...> base_t;
+
+    public:
+        typedef typename details::await_result<Args...>::type result_t;
+
+        using typename base_t::callback_traits_t;
+        using typename base_t::callback_t;
+        using base_t::size;
+        using base_t::clear;
+        using base_t::attach;
+        using base_t::attach_tracked;
+        using base_t::attach_once;
+        using base_t::attach_n;
+        using base_t::detach;
+        using base_t::connected;
+
+        class awaiter_t
+        {
+        public:
+            explicit awaiter_t(awaitable_delegates& owner) : owner(&owner) {}
+
+            awaiter_t(const awaiter_t&) = delete;
+            awaiter_t& operator=(const awaiter_t&) = delete;
+
+            ~awaiter_t()
+            {
+                if (list)
+                    list->unlink(this);
+            }
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<> coroutine)
+            {
+                handle = coroutine;
+                owner->waiters.link(this);
+            }
+
+            result_t await_resume()
+            {
+                if constexpr (!std::is_void<result_t>::value)
+                    return unpack(std::index_sequence_for<Args...>());
+            }
+
+        private:
+            friend class awaitable_delegates;
+
+            awaitable_delegates* owner;
+            awaiter_t* prev = nullptr;
+            awaiter_t* next = nullptr;
+            typename awaitable_delegates::waiter_list_t* list = nullptr;    // the list the node is in, if any
+            std::coroutine_handle<> handle;
+            std::optional<std::tuple<typename std::decay<Args>::type...>> value;
+
+            template<size_t... I>
+            result_t unpack(std::index_sequence<I...>)
+            {
+                if constexpr (sizeof...(Args) == 1)
+                    return std::move(std::get<0>(*value));
+                else
+                    return result_t(std::move(std::get<I>(*value))...);
+            }
+        };
+
+        awaitable_delegates() = default;
+        awaitable_delegates(const awaitable_delegates&) = delete;
+        awaitable_delegates& operator=(const awaitable_delegates&) = delete;
+
+        ~awaitable_delegates()
+        {
+            while (waiters.head)
+                waiters.unlink(waiters.head);
+        }
+
+        awaiter_t next() { return awaiter_t(*this); }
+
+        // number of coroutines waiting for the next call
+        size_t waiting() const { return waiters.count; }
+
+        void operator()(details::forward_t<Args>... args)
+        {
+            base_t::operator()(args...);
+            if (!waiters.head)
+                return;
+
+            // take the whole list first: resumed coroutines that wait again go to
+            // the next call.  the nodes stay linked (to this local list) until
+            // woken, so that a coroutine destroyed meanwhile still unlinks itself.
+            waiter_list_t waking;
+            waking.take(waiters);
+            wake_guard guard(*this, waking);
+            while (auto node = waking.head)
+            {
+                waking.unlink(node);
+                node->value.emplace(args...);
+                node->handle.resume();
+            }
+        }
+
+    protected:
+        // intrusive, doubly-linked list of awaiters
+        struct waiter_list_t
+        {
+            awaiter_t* head = nullptr;
+            awaiter_t* tail = nullptr;
+            size_t count = 0;
+
+            void link(awaiter_t* node)
+            {
+                node->prev = tail;
+                node->next = nullptr;
+                (tail ? tail->next : head) = node;
+                tail = node;
+                node->list = this;
+                ++count;
+            }
+
+            void unlink(awaiter_t* node)
+            {
+                (node->prev ? node->prev->next : head) = node->next;
+                (node->next ? node->next->prev : tail) = node->prev;
+                node->prev = node->next = nullptr;
+                node->list = nullptr;
+                --count;
+            }
+
+            // puts the nodes of other ahead of these
+            void prepend(waiter_list_t& other)
+            {
+                if (!other.head)
+                    return;
+                for (auto node = other.head; node; node = node->next)
+                    node->list = this;
+                other.tail->next = head;
+                (head ? head->prev : tail) = other.tail;
+                head = other.head;
+                count += other.count;
+                other.head = other.tail = nullptr;
+                other.count = 0;
+            }
+
+            void take(waiter_list_t& other)
+            {
+                head = other.head;
+                tail = other.tail;
+                count = other.count;
+                for (auto node = head; node; node = node->next)
+                    node->list = this;
+                other.head = other.tail = nullptr;
+                other.count = 0;
+            }
+        };
+
+        waiter_list_t waiters;
+
+        // gives the waiters left in waking back to the container, should a resume throw
+        struct wake_guard
+        {
+            awaitable_delegates& owner;
+            waiter_list_t& waking;
+            wake_guard(awaitable_delegates& owner, waiter_list_t& waking) : owner(owner), waking(waking) {}
+            ~wake_guard() { owner.waiters.prepend(waking); }
+        };
+    };
+
+} /// namespace creaky
+
+#endif // __cpp_impl_coroutine
+
+#endif /// __CREAKY_AWAITABLE_DELEGATES_T_H__
@@ -1,28 +1,345 @@
 #if !defined(__CREAKY_C11_DELEGATES_T_HPP__)
 #define __CREAKY_C11_DELEGATES_T_HPP__
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <new>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
+#include <vector>
+
+// functors up to this size are stored inside the delegate itself, instead of
+// on the heap.  the default fits a bound (object, method pointer) pair.
+#ifndef YAGLIB_DELEGATE_BUFFER_SIZE
+#define YAGLIB_DELEGATE_BUFFER_SIZE (3 * sizeof(void*))
+#endif
 
 template <typename T> class delegate;
+template <typename T> class unique_delegate;
+template <typename T> class delegate_ref;
+
+/**
+ * delegate_allocator
+ *
+ * memory source for functors too big for the inline buffer (and, for
+ * delegate, the shared_ptr control block).  each thread has a current
+ * allocator, the global heap unless changed with delegate_allocator_scope;
+ * delegates allocate from it when they are created, and every block
+ * remembers its allocator, so it can be freed from any thread.
+ */
+class delegate_allocator
+{
+public:
+  virtual ~delegate_allocator() = default;
+  virtual void* allocate(::std::size_t size) = 0;
+  virtual void deallocate(void* p, ::std::size_t size) noexcept = 0;
+
+  static delegate_allocator& heap() noexcept;
+
+  static delegate_allocator& current() noexcept
+  {
+    return *current_slot();
+  }
+
+  // returns the previous allocator of this thread
+  static delegate_allocator* exchange(delegate_allocator* const allocator) noexcept
+  {
+    auto previous = current_slot();
+    current_slot() = allocator ? allocator : &heap();
+    return previous;
+  }
+
+  // a block from the current allocator, prefixed with a header naming it
+  static void* allocate_block(::std::size_t const size)
+  {
+    auto& owner = current();
+    auto raw = static_cast<unsigned char*>(owner.allocate(header_size + size));
+    new (raw) header_type{ &owner, header_size + size };
+    return raw + header_size;
+  }
+
+  static void deallocate_block(void* const p) noexcept
+  {
+    auto raw = static_cast<unsigned char*>(p) - header_size;
+    auto header = reinterpret_cast<header_type*>(raw);
+    header->owner->deallocate(raw, header->size);
+  }
+
+private:
+  struct header_type
+  {
+    delegate_allocator* owner;
+    ::std::size_t size;
+  };
+
+  // keeps the functor that follows the header suitably aligned
+  static constexpr ::std::size_t header_size =
+    (sizeof(header_type) + alignof(::std::max_align_t) - 1) / alignof(::std::max_align_t) * alignof(::std::max_align_t);
+
+  class heap_allocator;
+
+  static delegate_allocator*& current_slot() noexcept
+  {
+    static thread_local delegate_allocator* allocator = &heap();
+    return allocator;
+  }
+};
+
+class delegate_allocator::heap_allocator : public delegate_allocator
+{
+public:
+  void* allocate(::std::size_t const size) override { return operator new(size); }
+  void deallocate(void* const p, ::std::size_t) noexcept override { operator delete(p); }
+};
+
+inline delegate_allocator& delegate_allocator::heap() noexcept
+{
+  static heap_allocator instance;
+  return instance;
+}
+
+/**
+ * makes allocator the current delegate allocator of this thread, for the
+ * lifetime of the scope.
+ */
+class delegate_allocator_scope
+{
+public:
+  explicit delegate_allocator_scope(delegate_allocator& allocator) noexcept :
+  previous_(delegate_allocator::exchange(&allocator))
+  {}
+
+  ~delegate_allocator_scope() { delegate_allocator::exchange(previous_); }
+
+  delegate_allocator_scope(delegate_allocator_scope const&) = delete;
+  delegate_allocator_scope& operator=(delegate_allocator_scope const&) = delete;
+
+private:
+  delegate_allocator* previous_;
+};
+
+/**
+ * std-style allocator over a delegate_allocator, used for the shared_ptr
+ * control blocks of delegate.
+ */
+template <class T>
+struct delegate_std_allocator
+{
+  using value_type = T;
+
+  delegate_allocator* owner;
+
+  explicit delegate_std_allocator(delegate_allocator& o) noexcept : owner(&o) {}
+
+  template <class U>
+  delegate_std_allocator(delegate_std_allocator<U> const& o) noexcept : owner(o.owner) {}
+
+  T* allocate(::std::size_t const n) { return static_cast<T*>(owner->allocate(n * sizeof(T))); }
+  void deallocate(T* const p, ::std::size_t const n) noexcept { owner->deallocate(p, n * sizeof(T)); }
+
+  template <class U>
+  bool operator==(delegate_std_allocator<U> const& rhs) const noexcept { return owner == rhs.owner; }
+
+  template <class U>
+  bool operator!=(delegate_std_allocator<U> const& rhs) const noexcept { return owner != rhs.owner; }
+};
+
+/**
+ * delegate_pool_allocator
+ *
+ * size-class pool: requests up to 512 bytes are rounded up to 32, 64, 128,
+ * 256 or 512 and served from per-class free lists, carved out of 16KB
+ * chunks.  larger ones go to the heap.  typically one pool per thread, so
+ * that threads creating delegates don't contend in malloc; the mutex only
+ * matters when a block is freed from another thread.
+ */
+class delegate_pool_allocator : public delegate_allocator
+{
+public:
+  delegate_pool_allocator() = default;
+  delegate_pool_allocator(delegate_pool_allocator const&) = delete;
+  delegate_pool_allocator& operator=(delegate_pool_allocator const&) = delete;
+
+  ~delegate_pool_allocator()
+  {
+    for (auto chunk : chunks_)
+      operator delete(chunk);
+  }
+
+  void* allocate(::std::size_t const size) override
+  {
+    auto const index = class_of(size);
+    if (index == class_count)
+      return operator new(size);
+
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    if (!free_[index])
+      refill(index);
+    auto node = free_[index];
+    free_[index] = node->next;
+    return node;
+  }
+
+  void deallocate(void* const p, ::std::size_t const size) noexcept override
+  {
+    auto const index = class_of(size);
+    if (index == class_count)
+    {
+      operator delete(p);
+      return;
+    }
+
+    ::std::lock_guard<::std::mutex> lock(mutex_);
+    auto node = static_cast<free_node*>(p);
+    node->next = free_[index];
+    free_[index] = node;
+  }
+
+private:
+  struct free_node
+  {
+    free_node* next;
+  };
+
+  static constexpr ::std::size_t class_count = 5;
+  static constexpr ::std::size_t smallest_class = 32;
+  static constexpr ::std::size_t chunk_size = 16 * 1024;
+
+  ::std::mutex mutex_;
+  free_node* free_[class_count] = {};
+  ::std::vector<void*> chunks_;
+
+  static ::std::size_t class_of(::std::size_t const size) noexcept
+  {
+    ::std::size_t index = 0;
+    while ((index < class_count) && ((smallest_class << index) < size))
+      ++index;
+    return index;
+  }
+
+  void refill(::std::size_t const index)
+  {
+    auto const block = smallest_class << index;
+    auto chunk = static_cast<unsigned char*>(operator new(chunk_size));
+    chunks_.push_back(chunk);
+    for (::std::size_t offset = 0; offset + block <= chunk_size; offset += block)
+    {
+      auto node = reinterpret_cast<free_node*>(chunk + offset);
+      node->next = free_[index];
+      free_[index] = node;
+    }
+  }
+};
+
+/**
+ * delegate_arena_allocator
+ *
+ * bump allocator for transient (e.g. per-frame) delegates.  freeing a block
+ * does nothing but count it; release() then recycles the whole arena at
+ * once, and expects every delegate allocated from it to be gone by then.
+ * allocation is meant for a single thread at a time.
+ */
+class delegate_arena_allocator : public delegate_allocator
+{
+public:
+  explicit delegate_arena_allocator(::std::size_t const chunk_size = 64 * 1024) :
+  chunk_size_(chunk_size)
+  {}
+
+  delegate_arena_allocator(delegate_arena_allocator const&) = delete;
+  delegate_arena_allocator& operator=(delegate_arena_allocator const&) = delete;
+
+  ~delegate_arena_allocator()
+  {
+    for (auto& chunk : chunks_)
+      operator delete(chunk.first);
+  }
+
+  void* allocate(::std::size_t size) override
+  {
+    size = (size + alignof(::std::max_align_t) - 1) / alignof(::std::max_align_t) * alignof(::std::max_align_t);
+    while ((current_ < chunks_.size()) && (offset_ + size > chunks_[current_].second))
+    {
+      ++current_;
+      offset_ = 0;
+    }
+    if (current_ == chunks_.size())
+    {
+      auto const capacity = size > chunk_size_ ? size : chunk_size_;
+      chunks_.emplace_back(operator new(capacity), capacity);
+      offset_ = 0;
+    }
+
+    auto p = static_cast<unsigned char*>(chunks_[current_].first) + offset_;
+    offset_ += size;
+    live_.fetch_add(1, ::std::memory_order_relaxed);
+    return p;
+  }
+
+  void deallocate(void*, ::std::size_t) noexcept override
+  {
+    live_.fetch_sub(1, ::std::memory_order_relaxed);
+  }
+
+  // number of blocks handed out and not yet freed
+  ::std::size_t live() const noexcept { return live_.load(::std::memory_order_relaxed); }
+
+  void release() noexcept
+  {
+    assert(live() == 0 && "delegates allocated from this arena are still alive");
+    current_ = 0;
+    offset_ = 0;
+  }
+
+private:
+  ::std::size_t chunk_size_;
+  ::std::vector<::std::pair<void*, ::std::size_t> > chunks_;
+  ::std::size_t current_ = 0;
+  ::std::size_t offset_ = 0;
+  ::std::atomic<::std::size_t> live_{ 0 };
+};
 
+/**
+ * delegate
+ *
+ * copyable callable: a function, an (object, method) pair or any functor.
+ * functors up to YAGLIB_DELEGATE_BUFFER_SIZE bytes are stored inline, larger
+ * ones in a heap block shared between copies.
+ *
+ * delegates made from functions and from (object, method) pairs compare by
+ * value, so two made from the same function, or the same object and method,
+ * are equal.  functors have no value to compare: a delegate made from one
+ * only equals its own copies, wherever the functor is stored, so the same
+ * lambda wrapped twice gives two different delegates.
+ *
+ * on 64-bit targets a delegate is 80 bytes, 24 of which are the inline
+ * buffer: that is what lets a bound (object, method) pair be stored
+ * without allocating.
+ */
 template<class R, class ...A>
 class delegate<R(A...)>
 {
   using stub_ptr_type = R(*)(void*, A&&...);
 
   delegate(void* const o, stub_ptr_type const m) noexcept :
-  object_ptr_(o), stub_ptr_(m), deleter_(nullptr), store_(nullptr), store_size_(0)
+  object_ptr_(o), stub_ptr_(m)
   {}
 
 public:
   delegate() = default;
-  delegate(delegate const&) = default;
-  delegate(delegate&&) = default;
+  delegate(delegate const& other) { copy_from(other); }
+  delegate(delegate&& other) noexcept { move_from(other); }
   delegate(::std::nullptr_t const) noexcept : delegate() { }
+  ~delegate() { destroy_buffer(); }
 
   template <class C, typename =
     typename ::std::enable_if < ::std::is_class<C>{} > ::type >
@@ -66,20 +383,30 @@ public:
     !::std::is_same<delegate, typename ::std::decay<T>::type>{}
     > ::type
   >
-      delegate(T&& f) :
-      store_(operator new(sizeof(typename ::std::decay<T>::type)),
-        functor_deleter<typename ::std::decay<T>::type>),
-      store_size_(sizeof(typename ::std::decay<T>::type))
+      delegate(T&& f)
+    {
+      store(::std::forward<T>(f));
+    }
+
+    delegate& operator=(delegate const& rhs)
     {
-      using functor_type = typename ::std::decay<T>::type;
-      new (store_.get()) functor_type(::std::forward<T>(f));
-      object_ptr_ = store_.get();
-      stub_ptr_ = functor_stub<functor_type>;
-      deleter_ = deleter_stub<functor_type>;
+      if (this != &rhs)
+      {
+        destroy_buffer();
+        copy_from(rhs);
+      }
+      return *this;
     }
 
-    delegate& operator=(delegate const&) = default;
-    delegate& operator=(delegate&&) = default;
+    delegate& operator=(delegate&& rhs) noexcept
+    {
+      if (this != &rhs)
+      {
+        destroy_buffer();
+        move_from(rhs);
+      }
+      return *this;
+    }
 
     template <class C>
     delegate& operator=(R(C::* const rhs)(A...))
@@ -101,24 +428,7 @@ public:
     >
         delegate& operator=(T&& f)
       {
-        using functor_type = typename ::std::decay<T>::type;
-        if ((sizeof(functor_type) > store_size_) || !store_.unique())
-        {
-          store_.reset(operator new(sizeof(functor_type)),
-            functor_deleter<functor_type>);
-
-          store_size_ = sizeof(functor_type);
-        }
-        else
-        {
-          deleter_(store_.get());
-        }
-
-        new (store_.get()) functor_type(::std::forward<T>(f));
-        object_ptr_ = store_.get();
-        stub_ptr_ = functor_stub<functor_type>;
-        deleter_ = deleter_stub<functor_type>;
-
+        store(::std::forward<T>(f));
         return *this;
       }
 
@@ -198,13 +508,13 @@ public:
         return const_member_pair<C>(&object, method_ptr);
       }
 
-      void reset() { stub_ptr_ = nullptr; store_.reset(); }
+      void reset() { destroy_buffer(); stub_ptr_ = nullptr; object_ptr_ = nullptr; store_.reset(); manager_ = nullptr; store_size_ = 0; identity_ = 0; }
       void reset_stub() noexcept { stub_ptr_ = nullptr; }
       void swap(delegate& other) noexcept { ::std::swap(*this, other); }
 
       bool operator==(delegate const& rhs) const noexcept
       {
-        return (object_ptr_ == rhs.object_ptr_) && (stub_ptr_ == rhs.stub_ptr_);
+        return (stub_ptr_ == rhs.stub_ptr_) && (identity_ == rhs.identity_) && (compare_target(rhs) == 0);
       }
 
       bool operator!=(delegate const& rhs) const noexcept
@@ -214,8 +524,11 @@ public:
 
       bool operator<(delegate const& rhs) const noexcept
       {
-        return (object_ptr_ < rhs.object_ptr_) ||
-          ((object_ptr_ == rhs.object_ptr_) && (stub_ptr_ < rhs.stub_ptr_));
+        if (identity_ != rhs.identity_)
+          return identity_ < rhs.identity_;
+        if (stub_ptr_ != rhs.stub_ptr_)
+          return ::std::less<stub_ptr_type>()(stub_ptr_, rhs.stub_ptr_);
+        return compare_target(rhs) < 0;
       }
 
       bool operator==(::std::nullptr_t const) const noexcept
@@ -238,24 +551,198 @@ public:
 
 private:
   friend struct ::std::hash<delegate>;
-  using deleter_type = void(*)(void*);
-  void* object_ptr_;
+  template <typename> friend class unique_delegate;
+  template <typename> friend class delegate_ref;
+
+  // move relocates (the source is destroyed), take leaves the moved-from source to its owner
+  enum class buffer_op { copy, move, take, destroy };
+  using manager_type = void(*)(buffer_op, void*, void*);
+
+  static constexpr ::std::size_t buffer_size = YAGLIB_DELEGATE_BUFFER_SIZE;
+
+  void* object_ptr_{};
   stub_ptr_type stub_ptr_{};
-  deleter_type deleter_;
+  manager_type manager_{};    // heap functors, and inline ones that aren't trivially copyable
   ::std::shared_ptr<void> store_;
-  ::std::size_t store_size_;
+  ::std::uint32_t store_size_{};
+  ::std::uint64_t identity_{};    // 0 for what compares by value, a serial shared by copies for functors
+  alignas(void*) unsigned char buffer_[buffer_size];
 
+  // small functors that can be relocated cheaply live in buffer_, anything else on the heap
   template <class T>
-  static void functor_deleter(void* const p)
+  using fits_buffer = ::std::integral_constant<bool,
+    (sizeof(T) <= buffer_size) && (alignof(T) <= alignof(void*)) &&
+    ::std::is_copy_constructible<T>{} && ::std::is_nothrow_move_constructible<T>{}>;
+
+  template <class T>
+  using trivial_functor = ::std::integral_constant<bool,
+    ::std::is_trivially_copyable<T>{} && ::std::is_trivially_destructible<T>{}>;
+
+  bool is_inline() const noexcept { return object_ptr_ == buffer_; }
+
+  // only called with equal identities: copies of a functor are equal whatever their
+  // storage, pointers compare their stored bytes, or the object pointer of a from<>()
+  int compare_target(delegate const& rhs) const noexcept
   {
-    static_cast<T*>(p)->~T();
-    operator delete(p);
+    if (identity_)
+      return 0;
+    if (!store_size_ || (store_size_ != rhs.store_size_))
+      return (object_ptr_ == rhs.object_ptr_) ? 0 : ::std::less<void*>()(object_ptr_, rhs.object_ptr_) ? -1 : 1;
+    return ::std::memcmp(object_ptr_, rhs.object_ptr_, store_size_);
+  }
+
+  // copies of a functor delegate share its serial; 0 is kept for by_value.  64 bits,
+  // so that serials never wrap around to one still in use
+  static ::std::uint64_t next_identity() noexcept
+  {
+    static ::std::atomic<::std::uint64_t> serial{ 0 };
+    ::std::uint64_t id;
+    while (!(id = serial.fetch_add(1, ::std::memory_order_relaxed) + 1))
+      ;
+    return id;
+  }
+
+  template <typename T>
+  typename ::std::enable_if<fits_buffer<typename ::std::decay<T>::type>{}>::type
+    store(T&& f)
+  {
+    using functor_type = typename ::std::decay<T>::type;
+    destroy_buffer();
+    store_.reset();
+
+    // zeroed first, so that the bytewise comparison doesn't see stale padding
+    ::std::memset(buffer_, 0, sizeof(buffer_));
+    new (buffer_) functor_type(::std::forward<T>(f));
+    object_ptr_ = buffer_;
+    stub_ptr_ = functor_stub<functor_type>;
+    manager_ = trivial_functor<functor_type>{} ? nullptr : buffer_manager<functor_type>;
+    store_size_ = sizeof(functor_type);
+    identity_ = by_value<functor_type>{} ? 0 : next_identity();
+  }
+
+  template <typename T>
+  typename ::std::enable_if<!fits_buffer<typename ::std::decay<T>::type>{}>::type
+    store(T&& f)
+  {
+    using functor_type = typename ::std::decay<T>::type;
+    destroy_buffer();
+
+    // the block is reused when nobody else holds it, and its deleter is that of functor_type
+    if (is_inline() || !store_ || (manager_ != buffer_manager<functor_type>) || (store_.use_count() != 1))
+    {
+      auto& allocator = delegate_allocator::current();
+      store_.reset(delegate_allocator::allocate_block(sizeof(functor_type)),
+        functor_deleter<functor_type>, delegate_std_allocator<char>(allocator));
+    }
+    else
+    {
+      manager_(buffer_op::destroy, store_.get(), nullptr);
+    }
+
+    if (by_value<functor_type>{})
+      ::std::memset(store_.get(), 0, sizeof(functor_type));
+    new (store_.get()) functor_type(::std::forward<T>(f));
+    object_ptr_ = store_.get();
+    stub_ptr_ = functor_stub<functor_type>;
+    manager_ = buffer_manager<functor_type>;
+    store_size_ = sizeof(functor_type);
+    identity_ = by_value<functor_type>{} ? 0 : next_identity();
+  }
+
+  void copy_from(delegate const& other)
+  {
+    stub_ptr_ = other.stub_ptr_;
+    store_ = other.store_;
+    store_size_ = other.store_size_;
+    identity_ = other.identity_;
+    manager_ = other.manager_;
+    if (other.is_inline())
+    {
+      if (manager_)
+      {
+        // the buffer may hold the bytes of a previous functor, which the hash would see
+        ::std::memset(buffer_, 0, sizeof(buffer_));
+        manager_(buffer_op::copy, buffer_, const_cast<unsigned char*>(other.buffer_));
+      }
+      else
+        ::std::memcpy(buffer_, other.buffer_, sizeof(buffer_));
+      object_ptr_ = buffer_;
+    }
+    else
+      object_ptr_ = other.object_ptr_;
+  }
+
+  // other is left empty
+  void move_from(delegate& other) noexcept
+  {
+    stub_ptr_ = other.stub_ptr_;
+    store_ = ::std::move(other.store_);
+    store_size_ = other.store_size_;
+    identity_ = other.identity_;
+    manager_ = other.manager_;
+    if (other.is_inline())
+    {
+      if (manager_)
+      {
+        ::std::memset(buffer_, 0, sizeof(buffer_));
+        manager_(buffer_op::move, buffer_, other.buffer_);
+      }
+      else
+        ::std::memcpy(buffer_, other.buffer_, sizeof(buffer_));
+      object_ptr_ = buffer_;
+    }
+    else
+      object_ptr_ = other.object_ptr_;
+
+    other.object_ptr_ = nullptr;
+    other.stub_ptr_ = nullptr;
+    other.manager_ = nullptr;
+    other.store_size_ = 0;
+    other.identity_ = 0;
+  }
+
+  void destroy_buffer() noexcept
+  {
+    if (is_inline())
+    {
+      if (manager_)
+        manager_(buffer_op::destroy, buffer_, nullptr);
+      object_ptr_ = nullptr;
+    }
+    if (!store_)
+      manager_ = nullptr;
+  }
+
+  template <class T>
+  static void buffer_manager(buffer_op const op, void* const dst, void* const src)
+  {
+    switch (op)
+    {
+    case buffer_op::copy:
+      // only ever needed to turn a shared heap block into a unique_delegate
+      if constexpr (::std::is_copy_constructible<T>::value)
+        new (dst) T(*static_cast<T const*>(src));
+      else
+        throw ::std::logic_error("delegate: a move-only functor shared by several delegates cannot be copied");
+      break;
+    case buffer_op::move:
+      new (dst) T(::std::move(*static_cast<T*>(src)));
+      static_cast<T*>(src)->~T();
+      break;
+    case buffer_op::take:
+      new (dst) T(::std::move(*static_cast<T*>(src)));
+      break;
+    case buffer_op::destroy:
+      static_cast<T*>(dst)->~T();
+      break;
+    }
   }
 
   template <class T>
-  static void deleter_stub(void* const p)
+  static void functor_deleter(void* const p)
   {
     static_cast<T*>(p)->~T();
+    delegate_allocator::deallocate_block(p);
   }
 
   template <R(*function_ptr)(A...)>
@@ -296,6 +783,11 @@ private:
   {
   };
 
+  // functions and (object, method) pairs, whose bytes are their identity
+  template <class T>
+  using by_value = ::std::integral_constant<bool,
+    ::std::is_same<T, R(*)(A...)>{} || is_member_pair<T>{} || is_const_member_pair<T>{}>;
+
   template <typename T>
   static typename ::std::enable_if <
     !(is_member_pair<T>{} ||
@@ -320,6 +812,427 @@ private:
   }
 };
 
+/**
+ * unique_delegate
+ *
+ * move-only sibling of delegate: the functor is owned exclusively, so there
+ * is no shared_ptr, no reference count and no atomic operation anywhere.
+ * move-only callables (e.g. lambdas capturing a std::unique_ptr) are
+ * accepted.  small functors are stored inline like in delegate, larger ones
+ * in a heap block owned by this object alone.
+ *
+ * the from<>() factories are the same as delegate's, and a delegate can be
+ * converted to a unique_delegate.
+ */
+template<class R, class ...A>
+class unique_delegate<R(A...)>
+{
+  using source_type = delegate<R(A...)>;
+  using stub_ptr_type = typename source_type::stub_ptr_type;
+
+  unique_delegate(void* const o, stub_ptr_type const m) noexcept :
+  object_ptr_(o), stub_ptr_(m)
+  {}
+
+public:
+  unique_delegate() = default;
+  unique_delegate(unique_delegate const&) = delete;
+  unique_delegate(unique_delegate&& other) noexcept { move_from(other); }
+  unique_delegate(::std::nullptr_t const) noexcept : unique_delegate() { }
+  ~unique_delegate() { destroy(); }
+
+  // the callable is taken out of d, not wrapped: pointers are adopted, an
+  // inline functor is moved into the buffer, a heap one into a block of its own.
+  // a heap block still shared with copies of d is copied, which throws
+  // std::logic_error for a move-only functor
+  unique_delegate(source_type d)
+  {
+    if (d.is_inline())
+    {
+      manager_ = d.manager_;
+      if (manager_)
+      {
+        manager_(buffer_op::move, buffer_, d.buffer_);
+        d.manager_ = nullptr;
+        d.object_ptr_ = nullptr;
+      }
+      else
+        ::std::memcpy(buffer_, d.buffer_, sizeof(buffer_));
+      object_ptr_ = buffer_;
+    }
+    else if (d.store_)
+    {
+      // copies of d may still share its block, which is then copied rather than moved from
+      auto const block = delegate_allocator::allocate_block(d.store_size_);
+      try
+      {
+        d.manager_(d.store_.use_count() == 1 ? buffer_op::take : buffer_op::copy, block, d.object_ptr_);
+      }
+      catch (...)
+      {
+        delegate_allocator::deallocate_block(block);
+        throw;
+      }
+      object_ptr_ = block;
+      manager_ = d.manager_;
+    }
+    else
+      object_ptr_ = d.object_ptr_;
+    stub_ptr_ = d.stub_ptr_;
+  }
+
+  template <class C>
+  unique_delegate(C* const object_ptr, R(C::* const method_ptr)(A...))
+  {
+    store(typename source_type::template member_pair<C>(object_ptr, method_ptr));
+  }
+
+  template <class C>
+  unique_delegate(C const* const object_ptr, R(C::* const method_ptr)(A...) const)
+  {
+    store(typename source_type::template const_member_pair<C>(object_ptr, method_ptr));
+  }
+
+  template <
+    typename T,
+    typename = typename ::std::enable_if <
+    !::std::is_same<unique_delegate, typename ::std::decay<T>::type>{} &&
+    !::std::is_same<source_type, typename ::std::decay<T>::type>{}
+    > ::type
+  >
+  unique_delegate(T&& f)
+  {
+    store(::std::forward<T>(f));
+  }
+
+  unique_delegate& operator=(unique_delegate const&) = delete;
+
+  unique_delegate& operator=(unique_delegate&& rhs) noexcept
+  {
+    if (this != &rhs)
+    {
+      destroy();
+      move_from(rhs);
+    }
+    return *this;
+  }
+
+  template <
+    typename T,
+    typename = typename ::std::enable_if <
+    !::std::is_same<unique_delegate, typename ::std::decay<T>::type>{}
+    > ::type
+  >
+  unique_delegate& operator=(T&& f)
+  {
+    return *this = unique_delegate(::std::forward<T>(f));
+  }
+
+  template <R(*const function_ptr)(A...)>
+  static unique_delegate from() noexcept
+  {
+    return{ nullptr, source_type::template function_stub<function_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...)>
+  static unique_delegate from(C* const object_ptr) noexcept
+  {
+    return{ object_ptr, source_type::template method_stub<C, method_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...) const>
+  static unique_delegate from(C const* const object_ptr) noexcept
+  {
+    return{ const_cast<C*>(object_ptr), source_type::template const_method_stub<C, method_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...)>
+  static unique_delegate from(C& object) noexcept
+  {
+    return{ &object, source_type::template method_stub<C, method_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...) const>
+  static unique_delegate from(C const& object) noexcept
+  {
+    return{ const_cast<C*>(&object), source_type::template const_method_stub<C, method_ptr> };
+  }
+
+  template <typename T>
+  static unique_delegate from(T&& f)
+  {
+    return unique_delegate(::std::forward<T>(f));
+  }
+
+  template <class C>
+  static unique_delegate from(C* const object_ptr,
+    R(C::* const method_ptr)(A...))
+  {
+    return unique_delegate(object_ptr, method_ptr);
+  }
+
+  template <class C>
+  static unique_delegate from(C const* const object_ptr,
+    R(C::* const method_ptr)(A...) const)
+  {
+    return unique_delegate(object_ptr, method_ptr);
+  }
+
+  void reset() noexcept { destroy(); }
+  void swap(unique_delegate& other) noexcept { ::std::swap(*this, other); }
+
+  // an owned functor lives at a unique address, so identity is enough here
+  bool operator==(unique_delegate const& rhs) const noexcept
+  {
+    return (object_ptr_ == rhs.object_ptr_) && (stub_ptr_ == rhs.stub_ptr_);
+  }
+
+  bool operator!=(unique_delegate const& rhs) const noexcept
+  {
+    return !operator==(rhs);
+  }
+
+  bool operator<(unique_delegate const& rhs) const noexcept
+  {
+    return (object_ptr_ < rhs.object_ptr_) ||
+      ((object_ptr_ == rhs.object_ptr_) && (stub_ptr_ < rhs.stub_ptr_));
+  }
+
+  bool operator==(::std::nullptr_t const) const noexcept
+  {
+    return !stub_ptr_;
+  }
+
+  bool operator!=(::std::nullptr_t const) const noexcept
+  {
+    return stub_ptr_;
+  }
+
+  explicit operator bool() const noexcept { return stub_ptr_; }
+
+  R operator()(A... args) const
+  {
+    return stub_ptr_(object_ptr_, ::std::forward<A>(args)...);
+  }
+
+private:
+  friend struct ::std::hash<unique_delegate>;
+  template <typename> friend class delegate_ref;
+
+  // the managers of delegate are shared, so that its functors can be taken over as they are;
+  // those made here are only ever asked to move and destroy
+  using buffer_op = typename source_type::buffer_op;
+  using manager_type = typename source_type::manager_type;
+
+  static constexpr ::std::size_t buffer_size = YAGLIB_DELEGATE_BUFFER_SIZE;
+
+  void* object_ptr_{};
+  stub_ptr_type stub_ptr_{};
+  manager_type manager_{};    // null when nothing is owned, or for trivial inline functors
+  alignas(void*) unsigned char buffer_[buffer_size];
+
+  template <class T>
+  using fits_buffer = ::std::integral_constant<bool,
+    (sizeof(T) <= buffer_size) && (alignof(T) <= alignof(void*)) &&
+    ::std::is_nothrow_move_constructible<T>{}>;
+
+  bool is_inline() const noexcept { return object_ptr_ == buffer_; }
+
+  template <typename T>
+  typename ::std::enable_if<fits_buffer<typename ::std::decay<T>::type>{}>::type
+    store(T&& f)
+  {
+    using functor_type = typename ::std::decay<T>::type;
+    new (buffer_) functor_type(::std::forward<T>(f));
+    object_ptr_ = buffer_;
+    stub_ptr_ = source_type::template functor_stub<functor_type>;
+    manager_ = (::std::is_trivially_copyable<functor_type>{} && ::std::is_trivially_destructible<functor_type>{})
+      ? nullptr : functor_manager<functor_type>;
+  }
+
+  template <typename T>
+  typename ::std::enable_if<!fits_buffer<typename ::std::decay<T>::type>{}>::type
+    store(T&& f)
+  {
+    using functor_type = typename ::std::decay<T>::type;
+    object_ptr_ = new (delegate_allocator::allocate_block(sizeof(functor_type))) functor_type(::std::forward<T>(f));
+    stub_ptr_ = source_type::template functor_stub<functor_type>;
+    manager_ = functor_manager<functor_type>;
+  }
+
+  void move_from(unique_delegate& other) noexcept
+  {
+    stub_ptr_ = other.stub_ptr_;
+    manager_ = other.manager_;
+    if (other.is_inline())
+    {
+      if (manager_)
+        manager_(buffer_op::move, buffer_, other.buffer_);
+      else
+        ::std::memcpy(buffer_, other.buffer_, sizeof(buffer_));
+      object_ptr_ = buffer_;
+    }
+    else
+      object_ptr_ = other.object_ptr_;
+
+    other.object_ptr_ = nullptr;
+    other.stub_ptr_ = nullptr;
+    other.manager_ = nullptr;
+  }
+
+  // heap functors are never moved, only their pointer is, and their block goes with them
+  void destroy() noexcept
+  {
+    if (manager_)
+    {
+      manager_(buffer_op::destroy, object_ptr_, nullptr);
+      if (!is_inline())
+        delegate_allocator::deallocate_block(object_ptr_);
+    }
+    object_ptr_ = nullptr;
+    stub_ptr_ = nullptr;
+    manager_ = nullptr;
+  }
+
+  template <class T>
+  static void functor_manager(buffer_op const op, void* const dst, void* const src)
+  {
+    if (op == buffer_op::move)
+    {
+      new (dst) T(::std::move(*static_cast<T*>(src)));
+      static_cast<T*>(src)->~T();
+    }
+    else if (op == buffer_op::destroy)
+      static_cast<T*>(dst)->~T();
+  }
+};
+
+/**
+ * delegate_ref
+ *
+ * non-owning, trivially copyable reference to something callable: just an
+ * object pointer and a stub pointer, built on the same stubs as delegate.
+ * it never allocates, and is meant for callback parameters that are called
+ * during the call and not kept (visitors, comparators...).  it converts
+ * implicitly from any callable, from a delegate and from a unique_delegate;
+ * whatever it refers to must outlive it.
+ */
+template<class R, class ...A>
+class delegate_ref<R(A...)>
+{
+  using source_type = delegate<R(A...)>;
+  using stub_ptr_type = typename source_type::stub_ptr_type;
+
+  delegate_ref(void* const o, stub_ptr_type const m) noexcept :
+  object_ptr_(o), stub_ptr_(m)
+  {}
+
+  template <typename T>
+  using is_function_like = ::std::integral_constant<bool,
+    ::std::is_function<typename ::std::remove_reference<T>::type>{} ||
+    ::std::is_function<typename ::std::remove_pointer<typename ::std::decay<T>::type>::type>{}>;
+
+public:
+  delegate_ref() = default;
+  delegate_ref(::std::nullptr_t const) noexcept : delegate_ref() { }
+
+  // a delegate's target is referenced directly, not through the delegate
+  delegate_ref(source_type const& d) noexcept :
+  object_ptr_(d.object_ptr_), stub_ptr_(d.stub_ptr_)
+  {}
+
+  delegate_ref(unique_delegate<R(A...)> const& d) noexcept :
+  object_ptr_(d.object_ptr_), stub_ptr_(d.stub_ptr_)
+  {}
+
+  delegate_ref(R(*const function_ptr)(A...)) noexcept :
+  object_ptr_(reinterpret_cast<void*>(function_ptr)), stub_ptr_(function_ptr_stub)
+  {}
+
+  template <
+    typename T,
+    typename = typename ::std::enable_if <
+    !::std::is_same<delegate_ref, typename ::std::decay<T>::type>{} &&
+    !::std::is_same<source_type, typename ::std::decay<T>::type>{} &&
+    !::std::is_same<unique_delegate<R(A...)>, typename ::std::decay<T>::type>{} &&
+    !is_function_like<T>{}
+    > ::type
+  >
+  delegate_ref(T&& f) noexcept :
+  object_ptr_(const_cast<void*>(static_cast<void const*>(::std::addressof(f)))),
+    stub_ptr_(source_type::template functor_stub<typename ::std::remove_reference<T>::type>)
+  {}
+
+  delegate_ref(delegate_ref const&) = default;
+  delegate_ref& operator=(delegate_ref const&) = default;
+
+  template <R(*const function_ptr)(A...)>
+  static delegate_ref from() noexcept
+  {
+    return{ nullptr, source_type::template function_stub<function_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...)>
+  static delegate_ref from(C* const object_ptr) noexcept
+  {
+    return{ object_ptr, source_type::template method_stub<C, method_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...) const>
+  static delegate_ref from(C const* const object_ptr) noexcept
+  {
+    return{ const_cast<C*>(object_ptr), source_type::template const_method_stub<C, method_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...)>
+  static delegate_ref from(C& object) noexcept
+  {
+    return{ &object, source_type::template method_stub<C, method_ptr> };
+  }
+
+  template <class C, R(C::* const method_ptr)(A...) const>
+  static delegate_ref from(C const& object) noexcept
+  {
+    return{ const_cast<C*>(&object), source_type::template const_method_stub<C, method_ptr> };
+  }
+
+  bool operator==(delegate_ref const& rhs) const noexcept
+  {
+    return (object_ptr_ == rhs.object_ptr_) && (stub_ptr_ == rhs.stub_ptr_);
+  }
+
+  bool operator!=(delegate_ref const& rhs) const noexcept
+  {
+    return !operator==(rhs);
+  }
+
+  bool operator==(::std::nullptr_t const) const noexcept
+  {
+    return !stub_ptr_;
+  }
+
+  bool operator!=(::std::nullptr_t const) const noexcept
+  {
+    return stub_ptr_;
+  }
+
+  explicit operator bool() const noexcept { return stub_ptr_; }
+
+  R operator()(A... args) const
+  {
+    return stub_ptr_(object_ptr_, ::std::forward<A>(args)...);
+  }
+
+private:
+  void* object_ptr_{};
+  stub_ptr_type stub_ptr_{};
+
+  static R function_ptr_stub(void* const function_ptr, A&&... args)
+  {
+    return reinterpret_cast<R(*)(A...)>(function_ptr)(::std::forward<A>(args)...);
+  }
+};
+
 namespace std
 {
 template <typename R, typename ...A>
@@ -327,12 +1240,389 @@ struct hash<::delegate<R(A...)> >
 {
   size_t operator()(::delegate<R(A...)> const& d) const noexcept
   {
-    auto const seed(hash<void*>()(d.object_ptr_));
+    // consistent with operator==: the serial of a functor, the bytes of a stored pointer
+    size_t seed(hash<void*>()(d.object_ptr_));
+    if (d.identity_)
+      seed = hash<::std::uint64_t>()(d.identity_);
+    else if (d.store_size_)
+    {
+      auto const bytes = static_cast<unsigned char const*>(d.object_ptr_);
+      seed = 14695981039346656037ull & ~size_t(0);
+      for (::std::size_t i = 0; i < d.store_size_; ++i)
+        seed = (seed ^ bytes[i]) * (1099511628211ull & ~size_t(0));
+    }
 
     return hash<typename ::delegate<R(A...)>::stub_ptr_type>()(
       d.stub_ptr_) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
   }
 };
+
+template <typename R, typename ...A>
+struct hash<::unique_delegate<R(A...)> >
+{
+  size_t operator()(::unique_delegate<R(A...)> const& d) const noexcept
+  {
+    auto const seed(hash<void*>()(d.object_ptr_));
+
+    return hash<decltype(d.stub_ptr_)>()(
+      d.stub_ptr_) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+};
 }
 
+/**
+ * combiners
+ *
+ * policies folding the results of the handlers of a multicast, one result
+ * at a time, into a value living on the stack of the call.  a fresh
+ * combiner is made for each call; operator() gets each result and returns
+ * false to stop the call right there, result() gives the result of the
+ * call.  folding over no handler at all gives the identity of the fold
+ * (0, the largest value for a min, true for all...).
+ *
+ * any type with result_type, operator() and result() can be used the same
+ * way.  for void handlers, operator() gets no argument.
+ */
+template <class T>
+struct combine_none
+{
+  using result_type = void;
+
+  bool operator()(T const&) const noexcept { return true; }
+  void result() const noexcept {}
+};
+
+template <>
+struct combine_none<void>
+{
+  using result_type = void;
+
+  bool operator()() const noexcept { return true; }
+  void result() const noexcept {}
+};
+
+template <class T>
+struct combine_sum
+{
+  using result_type = T;
+  T value{};
+
+  bool operator()(T const r) { value += r; return true; }
+  T result() const { return value; }
+};
+
+template <class T>
+struct combine_min
+{
+  using result_type = T;
+  T value{::std::numeric_limits<T>::max()};
+
+  bool operator()(T const r) { if (r < value) value = r; return true; }
+  T result() const { return value; }
+};
+
+template <class T>
+struct combine_max
+{
+  using result_type = T;
+  T value{::std::numeric_limits<T>::lowest()};
+
+  bool operator()(T const r) { if (value < r) value = r; return true; }
+  T result() const { return value; }
+};
+
+// stops at the first handler returning true
+struct combine_any
+{
+  using result_type = bool;
+  bool value{};
+
+  bool operator()(bool const r) noexcept { value = r; return !r; }
+  bool result() const noexcept { return value; }
+};
+
+// stops at the first handler returning false (a veto)
+struct combine_all
+{
+  using result_type = bool;
+  bool value{true};
+
+  bool operator()(bool const r) noexcept { value = r; return r; }
+  bool result() const noexcept { return value; }
+};
+
+// stops at the first result that converts to true (a pointer, a delegate...)
+template <class T>
+struct combine_first
+{
+  using result_type = T;
+  T value{};
+
+  bool operator()(T r)
+  {
+    if (!r)
+      return true;
+    value = ::std::move(r);
+    return false;
+  }
+
+  T result() { return ::std::move(value); }
+};
+
+/**
+ * multicast
+ *
+ * set of delegates called together.  handlers are kept in a dense vector,
+ * so a call is a plain walk over it, and an open-addressing index built on
+ * std::hash<delegate> and operator== (see delegate for what compares
+ * equal) makes add(), remove() and contains() O(1) however many handlers
+ * there are.  a delegate is only added once.
+ *
+ * remove() moves the last handler into the hole, so the call order is not
+ * kept across removals.  handlers may add and remove while being called:
+ * a removed handler is not called anymore, an added one is called from
+ * the next call on.
+ *
+ * the results of the handlers are folded by a combiner (see combine_sum
+ * and friends above), the result of the combiner being that of the call.
+ * the default one, combine_none, drops them.  fold<combiner>() calls with
+ * another combiner than that of the multicast.
+ */
+template <typename T, class Combiner = void> class multicast;
+
+template<class R, class ...A, class Combiner>
+class multicast<R(A...), Combiner>
+{
+public:
+  using delegate_type = delegate<R(A...)>;
+  using combiner_type = typename ::std::conditional<
+    ::std::is_void<Combiner>{}, combine_none<R>, Combiner>::type;
+  using result_type = typename combiner_type::result_type;
+  using const_iterator = typename ::std::vector<delegate_type>::const_iterator;
+
+  // false if d is empty or already there
+  bool add(delegate_type d)
+  {
+    if (!d || (lookup(d) != npos))
+      return false;
+
+    if ((count_ + 1) * 2 > index_.size())
+      grow();
+
+    auto const position(static_cast<::std::uint32_t>(handlers_.size() + pending_.size()));
+    if (depth_)
+      pending_.push_back(::std::move(d));
+    else
+      handlers_.push_back(::std::move(d));
+    dead_.push_back(false);
+
+    place(position);
+    ++count_;
+    return true;
+  }
+
+  bool remove(delegate_type const& d)
+  {
+    auto const slot(lookup(d));
+    if (slot == npos)
+      return false;
+
+    auto const position(index_[slot]);
+    erase_slot(slot);
+    --count_;
+
+    // the handler may be the one running, so it is only flagged until the call is over
+    if (depth_)
+      dead_[position] = true;
+    else
+      relocate(position);
+    return true;
+  }
+
+  bool contains(delegate_type const& d) const
+  {
+    return lookup(d) != npos;
+  }
+
+  ::std::size_t size() const noexcept { return count_; }
+  bool empty() const noexcept { return !count_; }
+
+  void clear()
+  {
+    if (depth_)
+    {
+      ::std::fill(dead_.begin(), dead_.end(), true);
+      ::std::fill(index_.begin(), index_.end(), empty_slot);
+    }
+    else
+    {
+      handlers_.clear();
+      dead_.clear();
+      index_.clear();
+    }
+    count_ = 0;
+  }
+
+  // only meaningful outside of a call, removed handlers stay in place until it returns
+  const_iterator begin() const noexcept { return handlers_.begin(); }
+  const_iterator end() const noexcept { return handlers_.end(); }
+
+  result_type operator()(A... args)
+  {
+    return fold<combiner_type>(args...);
+  }
+
+  template <class C>
+  typename C::result_type fold(A... args)
+  {
+    emit_scope const scope(*this);
+    C combiner;
+    for (::std::size_t i(0), n(handlers_.size()); i != n; ++i)
+    {
+      if (!dead_[i] && !feed(combiner, handlers_[i], ::std::is_void<R>(), args...))
+        break;
+    }
+    return combiner.result();
+  }
+
+private:
+  static constexpr ::std::size_t npos = ~::std::size_t(0);
+  static constexpr ::std::uint32_t empty_slot = ~::std::uint32_t(0);
+
+  // positions index handlers_, then pending_ (added during a call)
+  ::std::vector<delegate_type> handlers_;
+  ::std::vector<delegate_type> pending_;
+  ::std::vector<bool> dead_;
+  ::std::vector<::std::uint32_t> index_;
+  ::std::size_t count_{};
+  ::std::size_t depth_{};
+
+  struct emit_scope
+  {
+    multicast& owner;
+
+    explicit emit_scope(multicast& m) noexcept : owner(m) { ++owner.depth_; }
+
+    ~emit_scope()
+    {
+      if (!--owner.depth_)
+        owner.flush();
+    }
+  };
+
+  template <class C>
+  static bool feed(C& combiner, delegate_type const& d, ::std::true_type, A&... args)
+  {
+    d(args...);
+    return combiner();
+  }
+
+  template <class C>
+  static bool feed(C& combiner, delegate_type const& d, ::std::false_type, A&... args)
+  {
+    return combiner(d(args...));
+  }
+
+  delegate_type const& at(::std::size_t const position) const noexcept
+  {
+    return position < handlers_.size() ?
+      handlers_[position] : pending_[position - handlers_.size()];
+  }
+
+  ::std::size_t mask() const noexcept { return index_.size() - 1; }
+
+  ::std::size_t home(delegate_type const& d) const noexcept
+  {
+    // fibonacci hashing, since pointer hashes are mostly identity
+    return static_cast<::std::size_t>(::std::uint64_t(::std::hash<delegate_type>()(d)) *
+      0x9E3779B97F4A7C15ull >> 32) & mask();
+  }
+
+  ::std::size_t lookup(delegate_type const& d) const
+  {
+    if (!count_)
+      return npos;
+
+    for (auto i(home(d)); index_[i] != empty_slot; i = (i + 1) & mask())
+    {
+      if (at(index_[i]) == d)
+        return i;
+    }
+    return npos;
+  }
+
+  void place(::std::uint32_t const position)
+  {
+    auto i(home(at(position)));
+    while (index_[i] != empty_slot)
+      i = (i + 1) & mask();
+    index_[i] = position;
+  }
+
+  // backward-shift deletion, so no tombstones are needed
+  void erase_slot(::std::size_t i)
+  {
+    index_[i] = empty_slot;
+    for (auto j((i + 1) & mask()); index_[j] != empty_slot; j = (j + 1) & mask())
+    {
+      auto const h(home(at(index_[j])));
+      if (((j - h) & mask()) >= ((j - i) & mask()))
+      {
+        index_[i] = index_[j];
+        index_[j] = empty_slot;
+        i = j;
+      }
+    }
+  }
+
+  // fills the hole at position with the last handler
+  void relocate(::std::size_t const position)
+  {
+    auto const last(handlers_.size() - 1);
+    if (position != last)
+    {
+      auto i(home(handlers_[last]));
+      while (index_[i] != last)
+        i = (i + 1) & mask();
+      index_[i] = static_cast<::std::uint32_t>(position);
+      handlers_[position] = ::std::move(handlers_[last]);
+      dead_[position] = dead_[last];
+    }
+    handlers_.pop_back();
+    dead_.pop_back();
+  }
+
+  void grow()
+  {
+    index_.assign(index_.empty() ? 16 : index_.size() * 2, empty_slot);
+    for (::std::size_t i(0), n(dead_.size()); i != n; ++i)
+    {
+      if (!dead_[i])
+        place(static_cast<::std::uint32_t>(i));
+    }
+  }
+
+  void flush()
+  {
+    // pending handlers keep their positions once appended
+    for (auto& d : pending_)
+      handlers_.push_back(::std::move(d));
+    pending_.clear();
+
+    // from the back, so whatever relocate() moves in has already been checked
+    for (auto i(handlers_.size()); i--; )
+    {
+      if (dead_[i])
+        relocate(i);
+    }
+  }
+};
+
+// out-of-class definitions, needed before c++17 since they are bound to references
+template<class R, class ...A, class Combiner>
+constexpr ::std::size_t multicast<R(A...), Combiner>::npos;
+
+template<class R, class ...A, class Combiner>
+constexpr ::std::uint32_t multicast<R(A...), Combiner>::empty_slot;
+
 #endif /// __CREAKY_C11_DELEGATES_T_HPP__
@@ -0,0 +1,328 @@
+#pragma once
+#ifndef __CREAKY_COALESCING_DELEGATES_T_H__
+#define __CREAKY_COALESCING_DELEGATES_T_H__
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    /**
+     * coalesce_stats_t
+     * ----------------
+     *
+     * counters of a coalescing container, since it was built or last reset.
+     *
+     */
+    struct coalesce_stats_t
+    {
+        std::uint64_t emitted = 0;      // calls to operator()
+        std::uint64_t dispatched = 0;   // calls actually forwarded to the handlers
+        std::uint64_t dropped = 0;      // calls folded into one that was already waiting
+    };
+
+
+    namespace details
+    {
+        /**
+         * dispatch window shared by the coalescing containers: with no
+         * interval, every flush()/poll() dispatches; with one, poll() only
+         * dispatches once the interval has elapsed since the last dispatch.
+         */
+        class coalesce_window
+        {
+        public:
+            typedef std::chrono::steady_clock::time_point time_point_t;
+            typedef std::chrono::steady_clock::duration duration_t;
+
+            void set_interval(duration_t value) { interval = value; }
+            duration_t get_interval() const { return interval; }
+
+            const coalesce_stats_t& stats() const { return counters; }
+            void reset_stats() { counters = coalesce_stats_t(); }
+
+        protected:
+            duration_t interval = duration_t::zero();
+            time_point_t last{};
+            coalesce_stats_t counters;
+
+            bool due(time_point_t now) const { return now - last >= interval; }
+        };
+
+        /**
+         * where an option waits in a keyed_coalescing_delegates batch, kept in
+         * the option storage of mapped_delegates (picked from option_t the
+         * same way).  the storages clear() what they erase, hence the no-op.
+         */
+        struct waiting_position_t
+        {
+            size_t value = 0;
+            void clear() {}
+        };
+
+    } /// namespace details
+
+
+    /**
+     * coalescing_delegates
+     * --------------------
+     *
+     * basic_delegates that collapse bursts.  operator() only records its
+     * arguments; a call made while another is waiting replaces it (or is
+     * merged into it, see merge_with()), so the handlers see a single call
+     * per window however many happened:
+     *
+     *  - per frame: call flush() once per frame
+     *  - per N ms: set_interval(), then call poll() every frame; it only
+     *    dispatches once the interval has elapsed since the last dispatch
+     *
+     * merge_with(f) installs f(waiting, args...), which folds a new call into
+     * the waiting arguments (a tuple) instead of replacing them, e.g. to sum
+     * deltas or to or-combine dirty flags.
+     *
+     * calls made by handlers during a dispatch wait for the next one, and a
+     * flush() or poll() called from a handler does nothing.
+     *
+     */
+    template<typename... Args>
+    class coalescing_delegates : basic_delegates<Args...>, details::coalesce_window
+    {
+        typedef basic_delegates<Args...> base_t;
+        typedef details::coalesce_window window_t;
+
+    public:
+        typedef std::tuple<typename std::decay<Args>::type...> value_t;
+        typedef ::delegate<void(value_t&, details::forward_t<Args>...)> merge_t;
+
+        using typename base_t::callback_traits_t;
+        using typename base_t::callback_t;
+        using base_t::size;
+        using base_t::clear;
+        using base_t::attach;
+        using base_t::attach_tracked;
+        using base_t::attach_once;
+        using base_t::attach_n;
+        using base_t::detach;
+        using base_t::connected;
+
+        using typename window_t::time_point_t;
+        using typename window_t::duration_t;
+        using window_t::set_interval;
+        using window_t::get_interval;
+        using window_t::stats;
+        using window_t::reset_stats;
+
+        void operator()(details::forward_t<Args>... args)
+        {
+            ++counters.emitted;
+            if (!waiting)
+            {
+                waiting.emplace(args...);
+                return;
+            }
+
+            ++counters.dropped;
+            if (merge)
+                merge(*waiting, args...);
+            else
+                *waiting = value_t(args...);
+        }
+
+        // dispatches the waiting call, if any, whatever the interval
+        bool flush()
+        {
+            return dispatch(std::chrono::steady_clock::now());
+        }
+
+        // dispatches the waiting call if the interval has elapsed
+        bool poll(time_point_t now)
+        {
+            return due(now) && dispatch(now);
+        }
+
+        bool poll() { return poll(std::chrono::steady_clock::now()); }
+
+        bool pending() const { return waiting.has_value(); }
+        void discard() { waiting.reset(); }
+
+        template<typename F>
+        void merge_with(F f)
+        {
+            merge = merge_t(f);
+        }
+
+    protected:
+        std::optional<value_t> waiting;
+        merge_t merge;
+        bool dispatching = false;
+
+        struct dispatch_guard
+        {
+            coalescing_delegates& owner;
+            explicit dispatch_guard(coalescing_delegates& owner) : owner(owner) { owner.dispatching = true; }
+            ~dispatch_guard() { owner.dispatching = false; }
+        };
+
+        bool dispatch(time_point_t now)
+        {
+            if (dispatching || !waiting)
+                return false;
+
+            dispatch_guard guard(*this);
+            value_t value(std::move(*waiting));
+            waiting.reset();
+            last = now;
+            ++counters.dispatched;
+            forward(value, std::index_sequence_for<Args...>());
+            return true;
+        }
+
+        template<size_t... I>
+        void forward(const value_t& value, std::index_sequence<I...>)
+        {
+            base_t::operator()(std::get<I>(value)...);
+        }
+    };
+
+
+    /**
+     * keyed_coalescing_delegates
+     * --------------------------
+     *
+     * the per-key flavor, over mapped_delegates: calls are collapsed per
+     * option, so a dispatch forwards one call for each option that was hit
+     * since the previous one, in the order the options were first hit.
+     * flush(), poll() and merge_with() work as in coalescing_delegates;
+     * notify_all() is not coalesced.
+     *
+     * calls made by handlers during a dispatch wait for the next one, and a
+     * flush() or poll() called from a handler does nothing.
+     *
+     */
+    template<typename option_t, typename... Args>
+    class keyed_coalescing_delegates : mapped_delegates<option_t, Args...>, details::coalesce_window
+    {
+        typedef mapped_delegates<option_t, Args...> base_t;
+        typedef details::coalesce_window window_t;
+
+    public:
+        typedef std::tuple<typename std::decay<Args>::type...> value_t;
+        typedef ::delegate<void(value_t&, details::forward_t<Args>...)> merge_t;
+
+        using typename base_t::callback_t;
+        using base_t::notify_all;
+        using base_t::set_notify_unique;
+        using base_t::size;
+        using base_t::clear;
+        using base_t::attach;
+        using base_t::attach_tracked;
+        using base_t::attach_once;
+        using base_t::attach_n;
+        using base_t::detach;
+
+        using typename window_t::time_point_t;
+        using typename window_t::duration_t;
+        using window_t::set_interval;
+        using window_t::get_interval;
+        using window_t::stats;
+        using window_t::reset_stats;
+
+        void operator()(option_t opt, details::forward_t<Args>... args)
+        {
+            ++counters.emitted;
+            if (auto position = positions.find(opt))
+            {
+                ++counters.dropped;
+                auto& value = waiting[position->value].second;
+                if (merge)
+                    merge(value, args...);
+                else
+                    value = value_t(args...);
+                return;
+            }
+
+            positions.get(opt).value = waiting.size();
+            waiting.emplace_back(opt, value_t(args...));
+        }
+
+        bool flush()
+        {
+            return dispatch(std::chrono::steady_clock::now());
+        }
+
+        bool poll(time_point_t now)
+        {
+            return due(now) && dispatch(now);
+        }
+
+        bool poll() { return poll(std::chrono::steady_clock::now()); }
+
+        // number of options waiting for a dispatch
+        size_t pending() const { return waiting.size(); }
+
+        void discard()
+        {
+            waiting.clear();
+            positions.clear();
+        }
+
+        template<typename F>
+        void merge_with(F f)
+        {
+            merge = merge_t(f);
+        }
+
+    protected:
+        typedef std::vector<std::pair<option_t, value_t>> waiting_t;
+
+        waiting_t waiting;
+        waiting_t running;      // swapped with waiting on dispatch, reused from one to the next
+        typename details::select_option_storage<option_t, details::waiting_position_t>::type positions;
+        merge_t merge;
+        bool dispatching = false;
+
+        struct dispatch_guard
+        {
+            keyed_coalescing_delegates& owner;
+            explicit dispatch_guard(keyed_coalescing_delegates& owner) : owner(owner) { owner.dispatching = true; }
+            ~dispatch_guard()
+            {
+                owner.running.clear();
+                owner.dispatching = false;
+            }
+        };
+
+        bool dispatch(time_point_t now)
+        {
+            if (dispatching || waiting.empty())
+                return false;
+
+            dispatch_guard guard(*this);
+            running.swap(waiting);
+            positions.clear();
+            last = now;
+            for (auto& item : running)
+            {
+                ++counters.dispatched;
+                forward(item.first, item.second, std::index_sequence_for<Args...>());
+            }
+            return true;
+        }
+
+        template<size_t... I>
+        void forward(option_t opt, const value_t& value, std::index_sequence<I...>)
+        {
+            base_t::operator()(opt, std::get<I>(value)...);
+        }
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_COALESCING_DELEGATES_T_H__
@@ -0,0 +1,393 @@
+#pragma once
+#ifndef __CREAKY_CONCURRENT_DELEGATES_T_H__
+#define __CREAKY_CONCURRENT_DELEGATES_T_H__
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    namespace details
+    {
+        /**
+         * rcu_cell
+         * --------
+         *
+         * holds one immutable, atomically published value.  readers never lock
+         * and never retry: they bump the reader counter of the current epoch,
+         * load the published pointer, use it, then drop the counter (three
+         * atomic operations, so reading is wait-free).
+         *
+         * writers are serialized by a mutex.  they copy the current value,
+         * modify the copy, publish it, then wait for the readers that could
+         * still be looking at the old value before deleting it.  the epoch is
+         * flipped twice during that wait, so readers arriving after the
+         * publish are counted separately and cannot starve the writer.
+         *
+         * NOTE: a reader must not write to the same cell (i.e. a handler must
+         * not attach/detach on the container that is calling it), since the
+         * writer would end up waiting on itself.
+         *
+         */
+        template<typename T>
+        class rcu_cell
+        {
+        public:
+            rcu_cell() : current(new T()) {}
+            ~rcu_cell() { delete current.load(); }
+
+            rcu_cell(const rcu_cell&) = delete;
+            rcu_cell& operator=(const rcu_cell&) = delete;
+
+            template<typename F>
+            void read(F&& f) const
+            {
+                auto& counter = readers[epoch.load() & 1].count;
+                counter.fetch_add(1);
+                reader_guard guard(counter);
+                f(*current.load());
+            }
+
+            // f receives a mutable copy of the current value, and its result is returned.
+            // if f throws, the copy is discarded and nothing is published.
+            template<typename F>
+            auto update(F&& f)
+            {
+                std::lock_guard<std::mutex> lock(writer);
+                std::unique_ptr<T> next(new T(*current.load()));
+                if constexpr (std::is_void<decltype(f(*next))>::value)
+                {
+                    f(*next);
+                    publish(std::move(next));
+                }
+                else
+                {
+                    auto result = f(*next);
+                    publish(std::move(next));
+                    return result;
+                }
+            }
+
+        private:
+            struct alignas(64) reader_count_t
+            {
+                std::atomic<size_t> count{ 0 };
+            };
+
+            struct reader_guard
+            {
+                std::atomic<size_t>& counter;
+                explicit reader_guard(std::atomic<size_t>& counter) : counter(counter) {}
+                ~reader_guard() { counter.fetch_sub(1); }
+            };
+
+            void publish(std::unique_ptr<T> next)
+            {
+                std::unique_ptr<const T> old(current.exchange(next.release()));
+                synchronize();
+            }
+
+            void synchronize()
+            {
+                for (int phase = 0; phase < 2; phase++)
+                {
+                    auto parity = epoch.fetch_add(1) & 1;
+                    while (readers[parity].count.load() != 0)
+                        std::this_thread::yield();
+                }
+            }
+
+            std::atomic<const T*> current;
+            std::atomic<unsigned> epoch{ 0 };
+            mutable reader_count_t readers[2];
+            std::mutex writer;
+        };
+
+        /**
+         * immutable callback list used as a snapshot by the concurrent
+         * containers.  handles are serial numbers since the list is rebuilt on
+         * every write anyway.  the callbacks themselves are shared between
+         * snapshots: a write copies pointers, and a stateful functor keeps one
+         * state whichever snapshot calls it.
+         */
+        template<typename callback_t>
+        struct snapshot_list
+        {
+            struct info_t
+            {
+                std::uint64_t serial;
+                handler_key_t key;
+            };
+
+            std::vector<std::shared_ptr<callback_t>> callbacks;
+            std::vector<info_t> infos;
+
+            size_t find(const handler_key_t& key, const callback_t& cb) const
+            {
+                for (size_t i = 0; i < callbacks.size(); i++)
+                    if (key.keyed ? infos[i].key == key : *callbacks[i] == cb)
+                        return i;
+                return callbacks.size();
+            }
+
+            size_t find(connection_t connection) const
+            {
+                auto serial = (std::uint64_t(connection.generation) << 32) | connection.index;
+                for (size_t i = 0; i < infos.size(); i++)
+                    if (infos[i].serial == serial)
+                        return i;
+                return callbacks.size();
+            }
+
+            // functors are never merged with an existing entry, see findable_v
+            connection_t insert(const callback_t& cb, const handler_key_t& key, std::uint64_t serial, bool findable = true)
+            {
+                auto existing = findable ? find(key, cb) : callbacks.size();
+                if (existing != callbacks.size())
+                    serial = infos[existing].serial;
+                else
+                {
+                    callbacks.push_back(std::make_shared<callback_t>(cb));
+                    infos.push_back(info_t{ serial, key });
+                }
+                return connection_t{ std::uint32_t(serial), std::uint32_t(serial >> 32) };
+            }
+
+            void erase(size_t position)
+            {
+                if (position >= callbacks.size())
+                    return;
+                callbacks.erase(callbacks.begin() + position);
+                infos.erase(infos.begin() + position);
+            }
+        };
+
+    } /// namespace details
+
+
+    /**
+     * concurrent_delegates
+     * --------------------
+     *
+     * thread-safe counterpart of basic_delegates.  operator() may be called
+     * from any number of threads at once; it forwards over an immutable
+     * snapshot of the handler list and takes no lock.  attach()/detach()
+     * copy the list, publish the new copy atomically, and reclaim the old one
+     * once no emitting thread can still see it.
+     *
+     * this suits the usual pattern of events fired from worker threads with
+     * handlers changing rarely, on the main thread.  writes cost a full copy
+     * of the list of handler pointers.
+     *
+     */
+    template<typename... Args>
+    class concurrent_delegates
+    {
+    public:
+        typedef typename basic_delegates<Args...>::callback_t callback_t;
+
+        void operator()(details::forward_t<Args>... args) const
+        {
+            callbacks.read([&](const snapshot_t& snapshot) {
+                for (auto& cb : snapshot.callbacks)
+                    (*cb)(args...);
+            });
+        }
+
+        size_t size() const
+        {
+            size_t result = 0;
+            callbacks.read([&](const snapshot_t& snapshot) { result = snapshot.callbacks.size(); });
+            return result;
+        }
+
+        void clear()
+        {
+            callbacks.update([](snapshot_t& snapshot) { snapshot = snapshot_t(); });
+        }
+
+        template<typename T>
+        connection_t attach(T t)
+        {
+            return insert(callback_t(t), details::key_of(t), details::findable_v<callback_t, T>);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(T t, C c)
+        {
+            return insert(cbx(t, c), details::key_of(t, c));
+        }
+
+        void detach(connection_t connection)
+        {
+            callbacks.update([&](snapshot_t& snapshot) { snapshot.erase(snapshot.find(connection)); });
+        }
+
+        template<typename T>
+        void detach(T t)
+        {
+            static_assert(details::findable_v<callback_t, T>, "functors can only be detached through the connection_t returned by attach()");
+            erase(callback_t(t), details::key_of(t));
+        }
+
+        template<typename T, typename C>
+        void detach(T t, C c)
+        {
+            erase(cbx(t, c), details::key_of(t, c));
+        }
+
+    protected:
+        typedef details::snapshot_list<callback_t> snapshot_t;
+        details::rcu_cell<snapshot_t> callbacks;
+        std::atomic<std::uint64_t> serial{ 0 };
+
+        template<typename T, typename C>
+        callback_t cbx(T t, C c)
+        {
+            return details::callback_traits<void(details::forward_t<Args>...)>::bind(t, c);
+        }
+
+        connection_t insert(const callback_t& cb, const details::handler_key_t& key, bool findable = true)
+        {
+            auto id = serial.fetch_add(1);
+            return callbacks.update([&](snapshot_t& snapshot) { return snapshot.insert(cb, key, id, findable); });
+        }
+
+        void erase(const callback_t& cb, const details::handler_key_t& key)
+        {
+            callbacks.update([&](snapshot_t& snapshot) { snapshot.erase(snapshot.find(key, cb)); });
+        }
+    };
+
+
+    /**
+     * concurrent_mapped_delegates
+     * ---------------------------
+     *
+     * thread-safe counterpart of mapped_delegates, using the same snapshot
+     * scheme as concurrent_delegates.  the whole option map is one snapshot,
+     * so a write copies every sub-list.
+     *
+     */
+    template<typename option_t, typename... Args>
+    class concurrent_mapped_delegates
+    {
+    public:
+        typedef typename basic_delegates<Args...>::callback_t callback_t;
+
+        void notify_all(details::forward_t<Args>... args) const
+        {
+            callbacks.read([&](const map_t& snapshot) {
+                for (auto& item : snapshot)
+                    for (auto& cb : item.second.callbacks)
+                        (*cb)(args...);
+            });
+        }
+
+        void operator()(option_t opt, details::forward_t<Args>... args) const
+        {
+            callbacks.read([&](const map_t& snapshot) {
+                auto it = snapshot.find(opt);
+                if (it != snapshot.end())
+                    for (auto& cb : it->second.callbacks)
+                        (*cb)(args...);
+            });
+        }
+
+        size_t size() const
+        {
+            size_t result = 0;
+            callbacks.read([&](const map_t& snapshot) { result = snapshot.size(); });
+            return result;
+        }
+
+        void clear()
+        {
+            callbacks.update([](map_t& snapshot) { snapshot.clear(); });
+        }
+
+        template<typename T>
+        connection_t attach(option_t opt, T t)
+        {
+            return insert(opt, callback_t(t), details::key_of(t), details::findable_v<callback_t, T>);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(option_t opt, T t, C c)
+        {
+            return insert(opt, cbx(t, c), details::key_of(t, c));
+        }
+
+        void detach(option_t opt, connection_t connection)
+        {
+            callbacks.update([&](map_t& snapshot) {
+                auto it = snapshot.find(opt);
+                if (it != snapshot.end())
+                    it->second.erase(it->second.find(connection));
+                erase_empty(snapshot, it);
+            });
+        }
+
+        template<typename T>
+        void detach(option_t opt, T t)
+        {
+            static_assert(details::findable_v<callback_t, T>, "functors can only be detached through the connection_t returned by attach()");
+            erase(opt, callback_t(t), details::key_of(t));
+        }
+
+        template<typename T, typename C>
+        void detach(option_t opt, T t, C c)
+        {
+            erase(opt, cbx(t, c), details::key_of(t, c));
+        }
+
+    protected:
+        typedef details::snapshot_list<callback_t> list_t;
+        typedef std::map<option_t, list_t> map_t;
+        details::rcu_cell<map_t> callbacks;
+        std::atomic<std::uint64_t> serial{ 0 };
+
+        template<typename T, typename C>
+        callback_t cbx(T t, C c)
+        {
+            return details::callback_traits<void(details::forward_t<Args>...)>::bind(t, c);
+        }
+
+        connection_t insert(option_t opt, const callback_t& cb, const details::handler_key_t& key, bool findable = true)
+        {
+            auto id = serial.fetch_add(1);
+            return callbacks.update([&](map_t& snapshot) { return snapshot[opt].insert(cb, key, id, findable); });
+        }
+
+        void erase(option_t opt, const callback_t& cb, const details::handler_key_t& key)
+        {
+            callbacks.update([&](map_t& snapshot) {
+                auto it = snapshot.find(opt);
+                if (it != snapshot.end())
+                    it->second.erase(it->second.find(key, cb));
+                erase_empty(snapshot, it);
+            });
+        }
+
+        static void erase_empty(map_t& snapshot, typename map_t::iterator it)
+        {
+#ifdef YAGLIB_DELEGATES_ERASE_EMPTY
+            if (it != snapshot.end() && it->second.callbacks.empty())
+                snapshot.erase(it);
+#else
+            (void)snapshot;
+            (void)it;
+#endif // YAGLIB_DELEGATES_ERASE_EMPTY
+        }
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_CONCURRENT_DELEGATES_T_H__
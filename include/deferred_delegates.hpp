@@ -0,0 +1,233 @@
+#pragma once
+#ifndef __CREAKY_DEFERRED_DELEGATES_T_H__
+#define __CREAKY_DEFERRED_DELEGATES_T_H__
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    /**
+     * arg_span
+     * --------
+     *
+     * read-only view over one argument column of a deferred batch.  bool
+     * arguments are seen as arg_span<stored_bool>, see below.
+     *
+     */
+    template<typename T>
+    struct arg_span
+    {
+        const T* data = nullptr;
+        size_t count = 0;
+
+        size_t size() const { return count; }
+        const T& operator[](size_t i) const { return data[i]; }
+        const T* begin() const { return data; }
+        const T* end() const { return data + count; }
+    };
+
+
+    /**
+     * stored_bool
+     * -----------
+     *
+     * std::vector<bool> has no data(), so bool arguments are stored through
+     * this wrapper, which converts back to bool.
+     *
+     */
+    struct stored_bool
+    {
+        bool value;
+        stored_bool(bool value) : value(value) {}
+        operator bool() const { return value; }
+    };
+
+
+    namespace details
+    {
+        template<typename T>
+        struct column_value
+        {
+            typedef typename std::decay<T>::type type;
+        };
+
+        template<>
+        struct column_value<bool>
+        {
+            typedef stored_bool type;
+        };
+
+        template<typename T>
+        using column_value_t = typename column_value<typename std::decay<T>::type>::type;
+
+    } /// namespace details
+
+
+    /**
+     * deferred_delegates
+     * ------------------
+     *
+     * basic_delegates that queue instead of forwarding right away.  operator()
+     * only records its arguments, column by column (one vector per argument,
+     * reused from one frame to the next), and flush() later runs every handler
+     * over the whole batch, handler by handler, instead of bouncing between
+     * handlers once per event.
+     *
+     * attach()/detach() are those of basic_delegates.  attach_batch() installs
+     * handlers that receive the whole batch at once, as one arg_span per
+     * argument; they are called after the regular handlers.  dispatch() still
+     * forwards a single event immediately, to the regular handlers only.
+     *
+     * events queued by handlers while flushing are kept for the next flush().
+     *
+     */
+    template<typename... Args>
+    class deferred_delegates : basic_delegates<Args...>
+    {
+        typedef basic_delegates<Args...> base_t;
+
+    public:
+        typedef basic_delegates<arg_span<details::column_value_t<Args>>...> batch_delegates_t;
+
+        using typename base_t::callback_traits_t;
+        using typename base_t::callback_t;
+        using base_t::size;
+        using base_t::clear;
+        using base_t::attach;
+        using base_t::attach_tracked;
+        using base_t::attach_once;
+        using base_t::attach_n;
+        using base_t::detach;
+        using base_t::connected;
+
+        void operator()(details::forward_t<Args>... args)
+        {
+            record(std::index_sequence_for<Args...>(), args...);
+            ++count;
+        }
+
+        void dispatch(details::forward_t<Args>... args)
+        {
+            base_t::operator()(args...);
+        }
+
+        void flush()
+        {
+            if (flushing || count == 0)
+                return;
+
+            // swap buffers, so that handlers may queue events while the batch is running
+            std::swap(queued, running);
+            auto total = count;
+            count = 0;
+            flushing = true;
+            flush_guard guard(*this);
+            run(total, std::index_sequence_for<Args...>());
+        }
+
+        // number of events waiting for the next flush()
+        size_t pending() const { return count; }
+
+        void discard()
+        {
+            clear_columns(queued, std::index_sequence_for<Args...>());
+            count = 0;
+        }
+
+        template<typename T>
+        connection_t attach_batch(T t)
+        {
+            return batch_handlers.attach(t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach_batch(T t, C c)
+        {
+            return batch_handlers.attach(t, c);
+        }
+
+        void detach_batch(connection_t connection)
+        {
+            batch_handlers.detach(connection);
+        }
+
+        template<typename T>
+        void detach_batch(T t)
+        {
+            batch_handlers.detach(t);
+        }
+
+        template<typename T, typename C>
+        void detach_batch(T t, C c)
+        {
+            batch_handlers.detach(t, c);
+        }
+
+    protected:
+        typedef std::tuple<std::vector<details::column_value_t<Args>>...> columns_t;
+
+        columns_t queued;
+        columns_t running;
+        size_t count = 0;
+        bool flushing = false;
+        batch_delegates_t batch_handlers;
+
+        struct flush_guard
+        {
+            deferred_delegates& owner;
+            explicit flush_guard(deferred_delegates& owner) : owner(owner) {}
+            ~flush_guard()
+            {
+                owner.clear_columns(owner.running, std::index_sequence_for<Args...>());
+                owner.flushing = false;
+            }
+        };
+
+        template<size_t... I>
+        void record(std::index_sequence<I...>, details::forward_t<Args>... args)
+        {
+            (std::get<I>(queued).push_back(args), ...);
+        }
+
+        template<size_t... I>
+        void clear_columns(columns_t& columns, std::index_sequence<I...>)
+        {
+            (std::get<I>(columns).clear(), ...);
+        }
+
+        template<size_t... I>
+        void run(size_t total, std::index_sequence<I...>)
+        {
+            {
+                typename base_t::callback_list_t::emit_scope scope(this->callbacks);
+                auto& list = this->callbacks;
+                for (size_t h = 0; h < list.dense_size(); h++)
+                {
+                    auto& cb = list.data()[h];
+                    auto guarded = list.guarded();
+                    if (list.live_at(h) && guarded && list.expired(h))
+                        list.expire(h);
+
+                    // a handler detached mid-batch is dead from then on, which stops its run.
+                    // limited handlers get one call per event, as long as they have some left.
+                    for (size_t i = 0; i < total && list.live_at(h) && (!guarded || list.take_shot(h)); i++)
+                        cb(std::get<I>(running)[i]...);
+                    if (list.live_at(h) && guarded && list.spent(h))
+                        list.expire(h);
+                }
+            }
+
+            if (batch_handlers.size() > 0)
+                batch_handlers(arg_span<details::column_value_t<Args>>{ std::get<I>(running).data(), total }...);
+        }
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_DEFERRED_DELEGATES_T_H__
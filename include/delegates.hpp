@@ -5,19 +5,54 @@
 #include <vector>
 #include <map>
 #include <memory>
-#include <3rdParty/fast_delegates/FastDelegateWrapper.h>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
 // uncomment the following if you want empty items in the map to be removed
 // this is used by the mapped_delegates detach() member
 //#define YAGLIB_DELEGATES_ERASE_EMPTY
 
+// uncomment the following to store handlers as FastDelegate objects (which
+// needs the external 3rdParty/fast_delegates library) instead of the in-repo
+// delegate<> from c11delegates.hpp
+//#define YAGLIB_DELEGATES_USE_FASTDELEGATE
+
+// uncomment the following to have arguments that are not trivially copyable
+// (or larger than two pointers) passed as const& from operator() to the
+// handlers by default, see argument_traits
+//#define YAGLIB_DELEGATES_FORWARD_BY_REF
+
+// uncomment the following to let attach_tracked() follow godot::Object
+// instances through their ObjectID (needs godot-cpp)
+//#define YAGLIB_DELEGATES_TRACK_GODOT
+
+#ifdef YAGLIB_DELEGATES_USE_FASTDELEGATE
+#include <3rdParty/fast_delegates/FastDelegateWrapper.h>
+#else
+#include "c11delegates.hpp"
+#endif // YAGLIB_DELEGATES_USE_FASTDELEGATE
+
+#ifdef YAGLIB_DELEGATES_TRACK_GODOT
+#include <godot_cpp/classes/object.hpp>
+#include <godot_cpp/core/object.hpp>
+#endif // YAGLIB_DELEGATES_TRACK_GODOT
+
 namespace creaky
 {
 
     /**
      * this symbol controls how many arguments are supported by the template
-     * declaration/generation for delegates.  however, it cannot go beyond 8
-     * right now because it is a hard-coded cap inside FastDelegate.h
+     * declaration/generation for delegates.  it only applies to the FastDelegate
+     * storage, which cannot go beyond 8 because it is a hard-coded cap inside
+     * FastDelegate.h.  the default delegate<> storage has no such limit.
      */
     constexpr int YAGLIB_DELEGATES_MAX_ARGUMENTS_SUPPORTED = 8;
 
@@ -37,15 +72,905 @@ namespace creaky
      *  removes the previously installed handler.  note that there is a version
      *  that also accepts the function object along with the object reference.
      *  this is done in order to be able to find the handler in the list.
-     *  internally, fastdelegate objects are created, but to do comparison, the
+     *  internally, callback objects are created, but to do comparison, the
      *  original values used during attach must be provided.
      *
+     * attach<&Class::method>(object), detach<&Class::method>(object)
+     *  same as above, but the method is known at compile time, so the stored
+     *  callback calls it directly instead of going through a method pointer.
+     *
      * operator()
      *  various versions of operator() are declared for whatever number of
      *  arguments triggered the template expansion.  other delegate variations
      *  may have extra arguments required however.
      *
+     * attach() returns a connection_t handle.  passing it back to detach()
+     * removes the handler in O(1), without having to supply the original
+     * function/method/object values.
+     *
+     */
+
+    /**
+     * connection_t
+     * ------------
+     *
+     * lightweight handle returned by attach().  it is a slot index plus a
+     * generation counter, so a stale handle (one whose handler was already
+     * removed, and whose slot got reused) is simply ignored by detach().
+     *
+     */
+    struct connection_t
+    {
+        std::uint32_t index = ~std::uint32_t(0);
+        std::uint32_t generation = 0;
+
+        explicit operator bool() const { return index != ~std::uint32_t(0); }
+        bool operator==(const connection_t& rhs) const { return index == rhs.index && generation == rhs.generation; }
+        bool operator!=(const connection_t& rhs) const { return !operator==(rhs); }
+    };
+
+    /**
+     * priority_t
+     * ----------
+     *
+     * ordering hint for attach().  handlers with a higher priority are called
+     * first, and handlers of equal priority are called in attach order.
+     * plain attach() uses priority 0.
+     *
+     */
+    struct priority_t
+    {
+        int value = 0;
+
+        priority_t() = default;
+        explicit priority_t(int value) : value(value) {}
+    };
+
+    /**
+     * argument_traits
+     * ---------------
+     *
+     * how the containers pass an argument of type T along.  by default it is
+     * taken by value and handed to every handler by value, which copies it
+     * once per handler.  with by_ref, it is taken as const T& and forwarded
+     * as such, so a call never copies the payload; handlers must then take
+     * it as const T& too.  specialize this for heavy types:
+     *
+     *    template<> struct creaky::argument_traits<Dictionary> {
+     *        static constexpr bool by_ref = true;
+     *    };
+     *
+     * with YAGLIB_DELEGATES_FORWARD_BY_REF, by_ref defaults to true for
+     * anything not trivially copyable or larger than two pointers.
+     * reference arguments are always passed as they are.
+     *
+     */
+    template<typename T>
+    struct argument_traits
+    {
+#ifdef YAGLIB_DELEGATES_FORWARD_BY_REF
+        static constexpr bool by_ref = !std::is_trivially_copyable<T>::value || sizeof(T) > 2 * sizeof(void*);
+#else
+        static constexpr bool by_ref = false;
+#endif // YAGLIB_DELEGATES_FORWARD_BY_REF
+    };
+
+    namespace details
+    {
+        /**
+         * lifetime_registry
+         * -----------------
+         *
+         * one generation counter per live trackable object.  an object takes a
+         * slot when built and bumps its generation when destroyed, so handles
+         * (slot + generation) held by delegate lists go stale at once, without
+         * the lists being visited.  slots live in chunks that never move, so
+         * alive() takes no lock.
+         */
+        class lifetime_registry
+        {
+        public:
+            static std::uint64_t acquire()
+            {
+                auto& self = instance();
+                std::lock_guard<std::mutex> lock(self.writer);
+                std::uint32_t slot;
+                if (!self.free_slots.empty())
+                {
+                    slot = self.free_slots.back();
+                    self.free_slots.pop_back();
+                }
+                else
+                {
+                    slot = self.next++;
+                    assert(slot / chunk_size < max_chunks && "too many trackable objects");
+                    auto& chunk = self.chunks[slot / chunk_size];
+                    if (!chunk.load())
+                        chunk.store(new std::atomic<std::uint32_t>[chunk_size]());
+                }
+                return (std::uint64_t(at(slot).load()) << 32) | slot;
+            }
+
+            static void release(std::uint64_t id)
+            {
+                auto& self = instance();
+                std::lock_guard<std::mutex> lock(self.writer);
+                at(std::uint32_t(id)).fetch_add(1);
+                self.free_slots.push_back(std::uint32_t(id));
+            }
+
+            static bool alive(std::uint64_t id)
+            {
+                return at(std::uint32_t(id)).load() == std::uint32_t(id >> 32);
+            }
+
+        private:
+            static constexpr std::size_t chunk_size = 4096;
+            static constexpr std::size_t max_chunks = 4096;
+
+            struct state_t
+            {
+                std::mutex writer;
+                std::atomic<std::atomic<std::uint32_t>*> chunks[max_chunks] = {};
+                std::vector<std::uint32_t> free_slots;
+                std::uint32_t next = 0;
+
+                ~state_t()
+                {
+                    for (auto& chunk : chunks)
+                        delete[] chunk.load();
+                }
+            };
+
+            static state_t& instance()
+            {
+                static state_t state;
+                return state;
+            }
+
+            static std::atomic<std::uint32_t>& at(std::uint32_t slot)
+            {
+                return instance().chunks[slot / chunk_size].load()[slot % chunk_size];
+            }
+        };
+
+    } /// namespace details
+
+    /**
+     * trackable
+     * ---------
+     *
+     * base class for plain C++ objects whose handlers should go away with
+     * them.  handlers bound to one through attach_tracked() are skipped once
+     * it is destroyed, and dropped from the list during the next call, so
+     * the destructor costs O(1) however many lists the object joined.  a
+     * copy is a different object, with its own lifetime.
+     *
      */
+    class trackable
+    {
+    public:
+        trackable() : id(details::lifetime_registry::acquire()) {}
+        trackable(const trackable&) : trackable() {}
+        trackable& operator=(const trackable&) { return *this; }
+        ~trackable() { details::lifetime_registry::release(id); }
+
+        std::uint64_t lifetime_id() const { return id; }
+
+    private:
+        std::uint64_t id;
+    };
+
+    namespace details
+    {
+        /**
+         * how a tracked handler checks that its object still exists: a probe
+         * and the id it is given.  untracked handlers have no probe.
+         */
+        struct lifetime_t
+        {
+            bool (*probe)(std::uint64_t) = nullptr;
+            std::uint64_t id = 0;
+
+            bool tracked() const { return probe != nullptr; }
+            bool alive() const { return !probe || probe(id); }
+        };
+
+        inline lifetime_t lifetime_of(const trackable* object)
+        {
+            return lifetime_t{ &lifetime_registry::alive, object->lifetime_id() };
+        }
+
+#ifdef YAGLIB_DELEGATES_TRACK_GODOT
+        inline bool godot_alive(std::uint64_t id)
+        {
+            return godot::ObjectDB::get_instance(id) != nullptr;
+        }
+
+        inline lifetime_t lifetime_of(const godot::Object* object)
+        {
+            return lifetime_t{ &godot_alive, std::uint64_t(object->get_instance_id()) };
+        }
+#endif // YAGLIB_DELEGATES_TRACK_GODOT
+
+        // the type an argument declared as T is passed as, see argument_traits
+        template<typename T, bool = std::is_reference<T>::value>
+        struct forward_arg { typedef T type; };
+
+        template<typename T>
+        struct forward_arg<T, false>
+        {
+            typedef typename std::conditional<argument_traits<T>::by_ref, const T&, T>::type type;
+        };
+
+        template<typename T>
+        using forward_t = typename forward_arg<T>::type;
+
+        template<typename M>
+        struct method_traits;
+
+        template<typename C, typename R, typename... A>
+        struct method_traits<R(C::*)(A...)> { typedef C class_t; };
+
+        template<typename C, typename R, typename... A>
+        struct method_traits<R(C::*)(A...) const> { typedef const C class_t; };
+
+        /**
+         * callback_traits
+         * ---------------
+         *
+         * the storage type used for handlers, and how to build one.  the
+         * containers only ever go through this, so the storage can be swapped
+         * without touching them.
+         */
+        template<typename signature_t>
+        struct callback_traits;
+
+#ifdef YAGLIB_DELEGATES_USE_FASTDELEGATE
+        template<typename... Args>
+        struct callback_traits<void(Args...)>
+        {
+            static_assert(sizeof...(Args) <= YAGLIB_DELEGATES_MAX_ARGUMENTS_SUPPORTED, "Templated function has too many parameters");
+
+            typedef typename fastdelegate::FastDelegate<void(Args...)> type;
+
+            template<typename T, typename C>
+            static type bind(T t, C c)
+            {
+                type cb;
+                cb.bind(c, t);
+                return cb;
+            }
+
+            template<auto method>
+            static type bind(typename method_traits<decltype(method)>::class_t* object)
+            {
+                return bind(method, object);
+            }
+        };
+#else
+        template<typename... Args>
+        struct callback_traits<void(Args...)>
+        {
+            typedef ::delegate<void(Args...)> type;
+
+            template<typename T, typename C>
+            static type bind(T t, C c)
+            {
+                return type::from(c, t);
+            }
+
+            // goes straight through method_stub, no member pointer is stored
+            template<auto method>
+            static type bind(typename method_traits<decltype(method)>::class_t* object)
+            {
+                typedef typename std::remove_const<typename method_traits<decltype(method)>::class_t>::type class_t;
+                return type::template from<class_t, method>(object);
+            }
+        };
+#endif // YAGLIB_DELEGATES_USE_FASTDELEGATE
+
+        /**
+         * identity of a handler, built from the values given to attach(): the
+         * bound object (if any), plus the raw bits of the function or method
+         * pointer.  the same attach() arguments always produce the same key,
+         * which lets detach() find a handler through a hash lookup instead of
+         * comparing against every stored callback.
+         *
+         * handlers that can't be keyed this way (e.g. a pre-built callback_t)
+         * get an empty key, and are located by a linear == search instead.
+         */
+        struct handler_key_t
+        {
+            const void* object = nullptr;
+            std::uintptr_t bits[4] = {};    // big enough for any member pointer representation
+            bool keyed = false;
+
+            template<typename F>
+            static handler_key_t make(const void* object, const F& f)
+            {
+                static_assert(sizeof(F) <= sizeof(bits), "function pointer representation too large for handler_key_t");
+                handler_key_t key;
+                key.object = object;
+                std::memcpy(key.bits, &f, sizeof(F));
+                key.keyed = true;
+                return key;
+            }
+
+            bool operator==(const handler_key_t& rhs) const
+            {
+                return keyed == rhs.keyed && object == rhs.object && std::equal(bits, bits + 4, rhs.bits);
+            }
+        };
+
+        struct handler_key_hash
+        {
+            std::size_t operator()(const handler_key_t& key) const
+            {
+                std::size_t seed = std::hash<const void*>()(key.object);
+                for (auto word : key.bits)
+                    seed ^= std::hash<std::uintptr_t>()(word) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                return seed;
+            }
+        };
+
+        template<typename T>
+        inline handler_key_t key_of(const T& t)
+        {
+            if constexpr (std::is_pointer<T>::value && std::is_function<typename std::remove_pointer<T>::type>::value)
+                return handler_key_t::make(nullptr, t);
+            else
+                return handler_key_t();
+        }
+
+        template<typename T, typename C>
+        inline handler_key_t key_of(const T& t, const C& c)
+        {
+            if constexpr (std::is_member_function_pointer<T>::value && std::is_pointer<C>::value)
+                return handler_key_t::make(static_cast<const void*>(c), t);
+            else
+                return handler_key_t();
+        }
+
+        /**
+         * whether a handler given to attach() as t can be found again by value.
+         * function pointers have a key, and a prebuilt callback_t compares with
+         * ==.  functors (lambdas, function objects) have neither: the same one
+         * wrapped twice gives two callbacks that don't compare equal, so
+         * attach() always adds them as a new handler, and they are detached
+         * through the connection_t it returned.
+         */
+        template<typename callback_t, typename T>
+        constexpr bool findable_v = std::is_same<typename std::decay<T>::type, callback_t>::value
+            || (std::is_pointer<T>::value && std::is_function<typename std::remove_pointer<T>::type>::value);
+
+        /**
+         * handler_list
+         * ------------
+         *
+         * slot-map storage shared by the delegate containers.  callbacks are
+         * kept in a dense vector, by decreasing priority then in attach order,
+         * so that forwarding is a plain contiguous walk.  new handlers are
+         * always appended; when one outranks the end of the list, the entries
+         * appended since the list was last in order are sorted and merged
+         * back once, before the next walk, so attaching many prioritized
+         * handlers costs a single sort.  connection_t handles index a
+         * separate slot table that points into the dense vector, and keyed
+         * handlers are also registered in a hash index.
+         *
+         * removal only tombstones the entry (the callback is reset to empty);
+         * the dense vector is compacted in one pass once tombstones outnumber
+         * the live entries, which keeps removal O(1) amortized while still
+         * preserving handler order.
+         *
+         * the list is also safe to modify while it is being forwarded.  an
+         * emit_scope marks the walk; while one is active, new handlers go to a
+         * pending list, removed entries are only marked dead where they sit
+         * (the running handler may be the one being removed, and its closure
+         * may live inside the callback) and destroyed once the walk ends, and
+         * compaction is put off.  walks test entries with live().  the outermost emit_scope merges everything back when it
+         * goes away.  none of this allocates once the side lists have grown
+         * to their working size.
+         *
+         * containers that store per-handler data (see parametric variants) pass
+         * it as extra_t; it is kept in its own dense vector, parallel to the
+         * callbacks, so that it can be scanned on its own.
+         *
+         */
+        struct no_extra_t {};
+
+        template<typename callback_t, typename extra_t = no_extra_t>
+        class handler_list
+        {
+        public:
+            typedef typename std::vector<callback_t>::iterator iterator;
+
+            /**
+             * guards a forwarding pass.  the dense vector is neither resized
+             * nor reallocated while at least one of these is alive, so it is
+             * safe to range-for over the list for the lifetime of the scope.
+             */
+            class emit_scope
+            {
+            public:
+                explicit emit_scope(handler_list& list) : list(list) { if (list.depth++ == 0) list.settle(); }
+                ~emit_scope() { if (--list.depth == 0) list.flush(); }
+
+                emit_scope(const emit_scope&) = delete;
+                emit_scope& operator=(const emit_scope&) = delete;
+
+            private:
+                handler_list& list;
+            };
+
+            iterator begin() { return callbacks.begin(); }
+            iterator end() { return callbacks.end(); }
+
+            // dense views, tombstones included: see live()
+            callback_t* data() { return callbacks.data(); }
+            const extra_t* extras() const { return extra_values.data(); }
+            size_t dense_size() const { return callbacks.size(); }
+
+            size_t size() const { return live; }
+
+            // whether the entry at a dense position is to be called.  tombstones
+            // have an empty callback, except those made during the current walk
+            bool live_at(size_t position) const
+            {
+                return callbacks[position] && (buried.empty() || infos[position].slot != npos);
+            }
+            size_t slot_count() const { return slots.size(); }
+            bool emitting() const { return depth > 0; }
+
+            // number of calls of a handler that isn't limited
+            static constexpr std::uint32_t unlimited = ~std::uint32_t(0);
+
+            // whether a call must look at each entry: some live handler is bound
+            // to a tracked object, or has a limited number of calls
+            bool guarded() const { return tracked > 0 || limited > 0; }
+
+            // true once the tracked object of the entry is gone
+            bool expired(size_t position) const { return !infos[position].lifetime.alive(); }
+            bool expired(connection_t c) const { return contains(c) && !info_of(c).lifetime.alive(); }
+
+            // counts the call about to be made.  false if the entry has no call
+            // left, i.e. it is only waiting for its last call to return
+            bool take_shot(size_t position) { return take_shot(infos[position]); }
+            bool take_shot(connection_t c) { return contains(c) && take_shot(info_of(c)); }
+
+            // true once the entry made its last call
+            bool spent(size_t position) const { return infos[position].shots == 0; }
+            bool spent(connection_t c) const { return contains(c) && info_of(c).shots == 0; }
+
+            // removes the entry at a dense position, e.g. once expired or spent
+            void expire(size_t position)
+            {
+                if (infos[position].slot != npos)
+                    remove(connection_t{ infos[position].slot, slots[infos[position].slot].generation });
+            }
+
+            void clear()
+            {
+                if (emitting())
+                {
+                    for (std::uint32_t slot = 0; slot < slots.size(); slot++)
+                        remove(connection_t{ slot, slots[slot].generation });
+                    return;
+                }
+
+                callbacks.clear();
+                extra_values.clear();
+                infos.clear();
+                slots.clear();
+                free_slots.clear();
+                index.clear();
+                live = 0;
+                tracked = 0;
+                limited = 0;
+                unordered = false;
+            }
+
+            connection_t insert(const callback_t& cb, const handler_key_t& key, const extra_t& extra = extra_t(),
+                priority_t priority = priority_t(), const lifetime_t& lifetime = lifetime_t(), std::uint32_t shots = unlimited)
+            {
+                std::uint32_t slot;
+                if (free_slots.empty())
+                {
+                    slot = static_cast<std::uint32_t>(slots.size());
+                    slots.push_back(slot_t());
+                }
+                else
+                {
+                    slot = free_slots.back();
+                    free_slots.pop_back();
+                }
+
+                // while emitting, the new entry is parked right after the end of the
+                // dense vector.  its position is the one it will have once flush()
+                // appends the pending list, until flush() sorts it into place.
+                slots[slot].live = true;
+                if (emitting())
+                {
+                    slots[slot].position = static_cast<std::uint32_t>(callbacks.size() + pending.size());
+                    disorder(priority.value);
+                    pending.push_back(cb);
+                    pending_extras.push_back(extra);
+                    pending_infos.push_back(info_t{ slot, priority.value, key, lifetime, shots });
+                }
+                else
+                    place(cb, extra, info_t{ slot, priority.value, key, lifetime, shots });
+
+                if (key.keyed)
+                    index[key] = slot;
+                if (lifetime.tracked())
+                    ++tracked;
+                if (shots != unlimited)
+                    ++limited;
+                ++live;
+
+                return connection_t{ slot, slots[slot].generation };
+            }
+
+            bool remove(connection_t c)
+            {
+                if (!contains(c))
+                    return false;
+
+                auto position = slots[c.index].position;
+                bool parked = position >= callbacks.size();
+                auto& cb = parked ? pending[position - callbacks.size()] : callbacks[position];
+                auto& info = parked ? pending_infos[position - callbacks.size()] : infos[position];
+                if (info.key.keyed)
+                    index.erase(info.key);
+                if (info.lifetime.tracked())
+                    --tracked;
+                if (info.shots != unlimited)
+                    --limited;
+
+                // the callback may be running: it is destroyed once the walk is over
+                if (emitting() && !parked)
+                    buried.push_back(position);
+                else
+                    cb = callback_t();
+                info.slot = npos;
+                slots[c.index].live = false;
+                ++slots[c.index].generation;
+                free_slots.push_back(c.index);
+                --live;
+
+                if (!emitting() && (callbacks.size() - live) > live)
+                    compact();
+                return true;
+            }
+
+            // the callback behind c, or nullptr if c is stale or still pending
+            callback_t* get(connection_t c)
+            {
+                if (!contains(c) || slots[c.index].position >= callbacks.size())
+                    return nullptr;
+                return &callbacks[slots[c.index].position];
+            }
+
+            // the key the entry behind c was attached with, or nullptr if c is stale
+            const handler_key_t* key_of(connection_t c) const
+            {
+                return contains(c) ? &info_of(c).key : nullptr;
+            }
+
+            // the extra data of the entry behind c, pending or not, or nullptr if c is stale
+            extra_t* extra_of(connection_t c)
+            {
+                if (!contains(c))
+                    return nullptr;
+                auto position = slots[c.index].position;
+                return position < extra_values.size() ? &extra_values[position] : &pending_extras[position - extra_values.size()];
+            }
+
+            bool contains(connection_t c) const
+            {
+                return c.index < slots.size() && slots[c.index].live && slots[c.index].generation == c.generation;
+            }
+
+            connection_t find(const handler_key_t& key) const
+            {
+                auto it = index.find(key);
+                if (it == index.end())
+                    return connection_t();
+                return connection_t{ it->second, slots[it->second].generation };
+            }
+
+            // visits live, already merged entries in order as f(callback, key, connection)
+            template<typename F>
+            void for_each_live(F&& f)
+            {
+                if (!emitting())
+                    settle();
+                for (size_t i = 0; i < callbacks.size(); i++)
+                    if (infos[i].slot != npos)
+                        f(callbacks[i], infos[i].key, connection_t{ infos[i].slot, slots[infos[i].slot].generation });
+            }
+
+            connection_t find(const callback_t& cb) const
+            {
+                for (size_t i = 0; i < callbacks.size(); i++)
+                    if (infos[i].slot != npos && callbacks[i] == cb)
+                        return connection_t{ infos[i].slot, slots[infos[i].slot].generation };
+                for (size_t i = 0; i < pending.size(); i++)
+                    if (pending_infos[i].slot != npos && pending[i] == cb)
+                        return connection_t{ pending_infos[i].slot, slots[pending_infos[i].slot].generation };
+                return connection_t();
+            }
+
+        protected:
+            static constexpr std::uint32_t npos = ~std::uint32_t(0);
+
+            struct slot_t
+            {
+                std::uint32_t position = 0;
+                std::uint32_t generation = 0;
+                bool live = false;
+            };
+
+            struct info_t
+            {
+                std::uint32_t slot;
+                int priority;
+                handler_key_t key;
+                lifetime_t lifetime;
+                std::uint32_t shots;                // calls left, or unlimited
+            };
+
+            std::vector<callback_t> callbacks;      // hot: walked on every forward
+            std::vector<extra_t> extra_values;      // parallel to callbacks
+            std::vector<info_t> infos;              // cold: parallel to callbacks
+            std::vector<slot_t> slots;
+            std::vector<std::uint32_t> free_slots;
+            std::unordered_map<handler_key_t, std::uint32_t, handler_key_hash> index;
+            size_t live = 0;
+            size_t tracked = 0;
+            size_t limited = 0;
+
+            // deferred mutation state, only used while forwarding
+            std::uint32_t depth = 0;
+            std::vector<callback_t> pending;
+            std::vector<extra_t> pending_extras;
+            std::vector<info_t> pending_infos;
+            std::vector<std::uint32_t> buried;      // dense positions of the entries removed while walking
+            std::vector<callback_t> graveyard;
+            bool unordered = false;             // an appended entry must move ahead of the end
+            size_t sorted_size = 0;             // when unordered, the entries before this one are in order
+
+            const info_t& info_of(connection_t c) const
+            {
+                auto position = slots[c.index].position;
+                return position < infos.size() ? infos[position] : pending_infos[position - infos.size()];
+            }
+
+            info_t& info_of(connection_t c)
+            {
+                return const_cast<info_t&>(static_cast<const handler_list&>(*this).info_of(c));
+            }
+
+            static bool take_shot(info_t& info)
+            {
+                if (info.shots == unlimited)
+                    return true;
+                if (info.shots == 0)
+                    return false;
+                --info.shots;
+                return true;
+            }
+
+            // priority of the entry that currently ends the list, pending ones included
+            int lowest() const
+            {
+                if (!pending_infos.empty())
+                    return pending_infos.back().priority;
+                return infos.empty() ? std::numeric_limits<int>::min() : infos.back().priority;
+            }
+
+            // appended, pending or not, after every entry so far
+            void disorder(int priority)
+            {
+                if (unordered || priority <= lowest())
+                    return;
+                unordered = true;
+                sorted_size = callbacks.size();
+            }
+
+            void place(const callback_t& cb, const extra_t& extra, const info_t& info)
+            {
+                disorder(info.priority);
+                slots[info.slot].position = static_cast<std::uint32_t>(callbacks.size());
+                callbacks.push_back(cb);
+                extra_values.push_back(extra);
+                infos.push_back(info);
+            }
+
+            // puts the list back in order before it is walked
+            void settle()
+            {
+                if (unordered)
+                    sort();
+            }
+
+            void flush()
+            {
+                for (size_t i = 0; i < pending.size(); i++)
+                {
+                    callbacks.push_back(std::move(pending[i]));
+                    extra_values.push_back(std::move(pending_extras[i]));
+                    infos.push_back(pending_infos[i]);
+                }
+                pending.clear();
+                pending_extras.clear();
+                pending_infos.clear();
+
+                // destroyed last, once the list is consistent again: a closure going
+                // away may run code that touches the list
+                for (auto position : buried)
+                {
+                    graveyard.push_back(std::move(callbacks[position]));
+                    callbacks[position] = callback_t();
+                }
+                buried.clear();
+
+                if (unordered)
+                    sort();
+                if ((callbacks.size() - live) > live)
+                    compact();
+                graveyard.clear();
+            }
+
+            // only the entries appended since the list was last in order are sorted,
+            // then merged with the others.  tombstones keep their priority, so they
+            // are sorted like the live entries.
+            void sort()
+            {
+                std::vector<std::uint32_t> order(callbacks.size());
+                for (size_t i = 0; i < order.size(); i++)
+                    order[i] = static_cast<std::uint32_t>(i);
+                auto by_priority = [&](std::uint32_t a, std::uint32_t b) { return infos[a].priority > infos[b].priority; };
+                std::stable_sort(order.begin() + sorted_size, order.end(), by_priority);
+                std::inplace_merge(order.begin(), order.begin() + sorted_size, order.end(), by_priority);
+
+                std::vector<callback_t> sorted_callbacks;
+                std::vector<extra_t> sorted_extras;
+                std::vector<info_t> sorted_infos;
+                sorted_callbacks.reserve(order.size());
+                sorted_extras.reserve(order.size());
+                sorted_infos.reserve(order.size());
+                for (auto i : order)
+                {
+                    if (infos[i].slot != npos)
+                        slots[infos[i].slot].position = static_cast<std::uint32_t>(sorted_infos.size());
+                    sorted_callbacks.push_back(std::move(callbacks[i]));
+                    sorted_extras.push_back(std::move(extra_values[i]));
+                    sorted_infos.push_back(infos[i]);
+                }
+                callbacks.swap(sorted_callbacks);
+                extra_values.swap(sorted_extras);
+                infos.swap(sorted_infos);
+                unordered = false;
+            }
+
+            void compact()
+            {
+                size_t out = 0;
+                size_t sorted = 0;
+                for (size_t i = 0; i < callbacks.size(); i++)
+                {
+                    if (infos[i].slot == npos)
+                        continue;
+                    if (i < sorted_size)
+                        ++sorted;
+                    if (out != i)
+                    {
+                        callbacks[out] = std::move(callbacks[i]);
+                        extra_values[out] = std::move(extra_values[i]);
+                        infos[out] = infos[i];
+                    }
+                    slots[infos[out].slot].position = static_cast<std::uint32_t>(out);
+                    out++;
+                }
+                callbacks.resize(out);
+                extra_values.erase(extra_values.begin() + out, extra_values.end());
+                infos.resize(out);
+                sorted_size = sorted;
+            }
+        };
+
+        /**
+         * handler_store
+         * -------------
+         *
+         * base of the containers that keep their handlers in a handler_list
+         * (basic, static_parametric, mask, bit_indexed and parallel
+         * delegates): the list, and the lookups attach()/detach() share.  a
+         * handler is found again through its key, or through == when it was
+         * given as a prebuilt callback_t; functors never are, see findable_v.
+         *
+         */
+        template<typename extra_t, typename... Args>
+        class handler_store
+        {
+        public:
+            typedef callback_traits<void(forward_t<Args>...)> callback_traits_t;
+            typedef typename callback_traits_t::type callback_t;
+
+            size_t size() const { return callbacks.size(); }
+
+            bool connected(connection_t connection) const
+            {
+                return callbacks.contains(connection);
+            }
+
+        protected:
+            typedef handler_list<callback_t, extra_t> callback_list_t;
+            callback_list_t callbacks;
+
+            // the list itself, for the containers built over several stores (found through ADL)
+            friend callback_list_t& handlers_of(handler_store& store) { return store.callbacks; }
+
+            template<typename T, typename C>
+            static callback_t cbx(T t, C c)
+            {
+                return callback_traits_t::bind(t, c);
+            }
+
+            // keyed handlers go through the hash index, prebuilt callbacks fall back to ==
+            template<typename T>
+            inline connection_t find(const handler_key_t& key, T t)
+            {
+                if constexpr (!findable_v<callback_t, T>)
+                    return connection_t();
+                else
+                    return key.keyed ? callbacks.find(key) : callbacks.find(callback_t(t));
+            }
+
+            template<typename T, typename C>
+            inline connection_t find(const handler_key_t& key, T t, C c)
+            {
+                return key.keyed ? callbacks.find(key) : callbacks.find(cbx(t, c));
+            }
+
+            // the handler a detach(t) refers to
+            template<typename T>
+            connection_t find_attached(T t)
+            {
+                static_assert(findable_v<callback_t, T>, "functors can only be detached through the connection_t returned by attach()");
+                return find(key_of(t), t);
+            }
+
+            template<typename T, typename C>
+            connection_t find_attached(T t, C c)
+            {
+                return find(key_of(t, c), t, c);
+            }
+
+            // attaches t with extra, unless it is attached already: its connection is then returned as is
+            template<typename T>
+            connection_t insert_unique(const extra_t& extra, T t)
+            {
+                auto key = key_of(t);
+                auto existing = find(key, t);
+                if (existing)
+                    return existing;
+                return callbacks.insert(callback_t(t), key, extra);
+            }
+
+            template<typename T, typename C>
+            connection_t insert_unique(const extra_t& extra, T t, C c, const lifetime_t& lifetime = lifetime_t())
+            {
+                auto key = key_of(t, c);
+                auto existing = find(key, t, c);
+                if (existing)
+                    return existing;
+                return callbacks.insert(cbx(t, c), key, extra, priority_t(), lifetime);
+            }
+        };
+
+    } /// namespace details
 
      /**
       * basic_delegates
@@ -56,91 +981,201 @@ namespace creaky
       *
       */
     template<typename... Args>
-    class basic_delegates
+    class basic_delegates : public details::handler_store<details::no_extra_t, Args...>
     {
-        static_assert(sizeof...(Args) <= YAGLIB_DELEGATES_MAX_ARGUMENTS_SUPPORTED, "Templated function has too many parameters");
+        typedef details::handler_store<details::no_extra_t, Args...> store_t;
 
     public:
-        typedef typename fastdelegate::FastDelegate<void(Args...)> callback_t;
+        using typename store_t::callback_traits_t;
+        using typename store_t::callback_t;
+        using store_t::size;
+        using store_t::connected;
 
-        void operator()(Args... args)
+        /**
+         * handlers may attach()/detach() on this same container while being
+         * called.  a handler attached during forwarding is first called on the
+         * next operator(); one detached during forwarding is not called again,
+         * even later in the current pass.
+         */
+        void operator()(details::forward_t<Args>... args)
         {
-            for (auto& cb : callbacks)
-                cb(args...);
+            typename callback_list_t::emit_scope scope(callbacks);
+            if (callbacks.guarded())
+                return forward_guarded(args...);
+
+            for (size_t i = 0; i < callbacks.dense_size(); i++)
+                if (callbacks.live_at(i))
+                    callbacks.data()[i](args...);
         }
 
-        size_t size() const { return callbacks.size(); }
-        void clear() { callbacks.clear(); };
+        void clear() { callbacks.clear(); }
 
         template<typename T>
-        void attach(T t)
+        connection_t attach(T t)
         {
-            if (!exists(t))
-                callbacks.push_back(callback_t(t));
+            return this->insert_unique(details::no_extra_t(), t);
         }
 
         template<typename T, typename C>
-        void attach(T t, C c)
+        connection_t attach(T t, C c)
         {
-            if (!exists(t, c))
-                callbacks.push_back(cbx(t, c));
+            return this->insert_unique(details::no_extra_t(), t, c);
         }
 
+        template<auto method>
+        connection_t attach(typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            return attach<method>(priority_t(), object);
+        }
+
+        /**
+         * same as above, but handlers are called by decreasing priority (ties
+         * in attach order).  a handler that is already attached keeps its
+         * place and its priority.
+         */
         template<typename T>
-        void detach(T t)
+        connection_t attach(priority_t priority, T t)
         {
-            auto it = find(callback_t(t));
-            if (it != callbacks.end())
-                callbacks.erase(it);
+            auto key = details::key_of(t);
+            auto existing = this->find(key, t);
+            if (existing)
+                return existing;
+            return callbacks.insert(callback_t(t), key, details::no_extra_t(), priority);
         }
 
         template<typename T, typename C>
-        void detach(T t, C c)
+        connection_t attach(priority_t priority, T t, C c)
         {
-            auto it = find(cbx(t, c));
-            if (it != callbacks.end())
-                callbacks.erase(it);
+            auto key = details::key_of(t, c);
+            auto existing = this->find(key, t, c);
+            if (existing)
+                return existing;
+            return callbacks.insert(this->cbx(t, c), key, details::no_extra_t(), priority);
         }
 
-    protected:
-        typedef std::vector<callback_t> callback_list_t;
-        callback_list_t callbacks;
+        template<auto method>
+        connection_t attach(priority_t priority, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            auto key = details::key_of(method, object);
+            auto existing = callbacks.find(key);
+            if (existing)
+                return existing;
+            return callbacks.insert(callback_traits_t::template bind<method>(object), key, details::no_extra_t(), priority);
+        }
+
+        /**
+         * attach() for handlers bound to an object that may be destroyed while
+         * still attached: one derived from trackable, or a godot::Object with
+         * YAGLIB_DELEGATES_TRACK_GODOT.  once the object is gone its handler
+         * is no longer called, and it is detached during the next call.  a
+         * handler that is already attached is returned as is, untracked if it
+         * was attached with attach().
+         */
+        template<typename T, typename C>
+        connection_t attach_tracked(T t, C* c)
+        {
+            return this->insert_unique(details::no_extra_t(), t, c, details::lifetime_of(c));
+        }
+
+        template<auto method>
+        connection_t attach_tracked(typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            auto key = details::key_of(method, object);
+            auto existing = callbacks.find(key);
+            if (existing)
+                return existing;
+            return callbacks.insert(callback_traits_t::template bind<method>(object), key, details::no_extra_t(),
+                priority_t(), details::lifetime_of(object));
+        }
+
+        /**
+         * handlers called only for the next call (attach_once) or the next
+         * count calls (attach_n), then detached.  they are swept with the
+         * rest of the tombstones once the call returns, so they are cheap to
+         * attach by the thousands.  a handler that is already attached is
+         * returned as is, with its own count.
+         */
+        template<typename T>
+        connection_t attach_once(T t)
+        {
+            return attach_n(1, t);
+        }
 
         template<typename T, typename C>
-        callback_t cbx(T t, C c)
+        connection_t attach_once(T t, C c)
         {
-            callback_t cb;
-            cb.bind(c, t);
-            return cb;
+            return attach_n(1, t, c);
         }
 
         template<typename T>
-        inline bool exists(T t)
+        connection_t attach_n(std::uint32_t count, T t)
         {
-            return find(t) != callbacks.end();
+            auto key = details::key_of(t);
+            auto existing = this->find(key, t);
+            if (existing || count == 0)
+                return existing;
+            return callbacks.insert(callback_t(t), key, details::no_extra_t(), priority_t(), details::lifetime_t(), count);
         }
 
         template<typename T, typename C>
-        inline bool exists(T t, C c)
+        connection_t attach_n(std::uint32_t count, T t, C c)
         {
-            return find(t, c) != callbacks.end();
+            auto key = details::key_of(t, c);
+            auto existing = this->find(key, t, c);
+            if (existing || count == 0)
+                return existing;
+            return callbacks.insert(this->cbx(t, c), key, details::no_extra_t(), priority_t(), details::lifetime_t(), count);
+        }
+
+        void detach(connection_t connection)
+        {
+            callbacks.remove(connection);
         }
 
         template<typename T>
-        inline auto find(T t)
+        void detach(T t)
         {
-            return find(callback_t(t));
+            callbacks.remove(this->find_attached(t));
         }
 
         template<typename T, typename C>
-        inline auto find(T t, C c)
+        void detach(T t, C c)
         {
-            return find(cbx(t, c));
+            callbacks.remove(this->find_attached(t, c));
         }
 
-        inline auto find(const callback_t& cb)
+        template<auto method>
+        void detach(typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            callbacks.remove(callbacks.find(details::key_of(method, object)));
+        }
+
+    protected:
+        using typename store_t::callback_list_t;
+        using store_t::callbacks;
+
+        // handlers whose object is gone, or that made their last call, are
+        // detached on the way; the emit_scope of the caller then compacts them
+        // all in one pass
+        void forward_guarded(details::forward_t<Args>... args)
         {
-            return std::find(callbacks.begin(), callbacks.end(), cb);
+            for (size_t i = 0; i < callbacks.dense_size(); i++)
+            {
+                if (!callbacks.live_at(i))
+                    continue;
+                auto& cb = callbacks.data()[i];
+                if (callbacks.expired(i))
+                {
+                    callbacks.expire(i);
+                    continue;
+                }
+                if (!callbacks.take_shot(i))
+                    continue;
+
+                cb(args...);
+                if (callbacks.spent(i))
+                    callbacks.expire(i);
+            }
         }
     };
 
@@ -165,9 +1200,9 @@ namespace creaky
     template<typename extra_data_t, typename... Args>
     class parametric_delegates {
     public:
-        typedef typename fastdelegate::FastDelegate<void(Args... args)> callback_t;
+        typedef typename details::callback_traits<void(details::forward_t<Args>...)>::type callback_t;
 
-        void operator()(Args... args)
+        void operator()(details::forward_t<Args>... args)
         {
             for (auto& cb : callbacks)
                 if (canForward(cb.extra, args...))
@@ -194,6 +1229,7 @@ namespace creaky
         template<typename T>
         void detach(T t)
         {
+            static_assert(details::findable_v<callback_t, T>, "functors can only be detached through the connection_t returned by attach()");
             auto it = find(t);
             if (it != callbacks.end())
                 callbacks.erase(it);
@@ -221,9 +1257,7 @@ namespace creaky
         template<typename T, typename C>
         callback_t cbx(T t, C c)
         {
-            callback_t cb;
-            cb.bind(c, t);
-            return cb;
+            return details::callback_traits<void(details::forward_t<Args>...)>::bind(t, c);
         }
 
         template<typename T>
@@ -241,7 +1275,10 @@ namespace creaky
         template<typename T>
         inline auto find(T t)
         {
-            return find(callback_t(t));
+            if constexpr (!details::findable_v<callback_t, T>)
+                return callbacks.end();
+            else
+                return find(callback_t(t));
         }
 
         template<typename T, typename C>
@@ -255,102 +1292,725 @@ namespace creaky
             return std::find_if(callbacks.begin(), callbacks.end(), [&](auto& item) { return item.callback == cb; });
         }
 
-        virtual bool canForward(const extra_data_t, Args...) { return true; };
+        virtual bool canForward(const extra_data_t, details::forward_t<Args>...) { return true; };
+    };
+
+
+    /**
+     * static_parametric_delegates
+     * ---------------------------
+     *
+     * same idea as parametric_delegates, but the forwarding predicate is bound
+     * at compile time (CRTP) instead of through a virtual call, so it can be
+     * inlined.  derive from it, passing the derived class as derived_t, and
+     * declare:
+     *
+     *    bool can_forward(const extra_data_t& extra, Args... args);
+     *
+     * forwarding goes through can_forward_batch(), which receives a run of the
+     * stored extra values (they are kept contiguously, apart from the
+     * callbacks) and fills in one flag per value.  the default just calls
+     * can_forward() in a loop; a derived class may declare its own
+     * can_forward_batch() with the same signature to test the whole run at
+     * once, e.g. with a loop the compiler can vectorize:
+     *
+     *    void can_forward_batch(const extra_data_t* extras, size_t count, bool* result, Args... args);
+     *
+     * handlers whose flag is set are then called in attach order.  extra_data_t
+     * must be default constructible.
+     *
+     */
+    template<typename derived_t, typename extra_data_t, typename... Args>
+    class static_parametric_delegates : public details::handler_store<extra_data_t, Args...>
+    {
+        typedef details::handler_store<extra_data_t, Args...> store_t;
+
+    public:
+        using typename store_t::callback_t;
+
+        // number of extra values handed to can_forward_batch() in one go
+        static constexpr size_t batch_size = 64;
+
+        void operator()(details::forward_t<Args>... args)
+        {
+            typename callback_list_t::emit_scope scope(callbacks);
+            auto& self = *static_cast<derived_t*>(this);
+            const auto count = callbacks.dense_size();
+            bool forward[batch_size];
+
+            for (size_t base = 0; base < count; base += batch_size)
+            {
+                auto run = std::min(batch_size, count - base);
+                self.can_forward_batch(callbacks.extras() + base, run, forward, args...);
+
+                // re-read the callback pointer: handlers may detach others, but never move them
+                for (size_t i = 0; i < run; i++)
+                {
+                    auto& cb = callbacks.data()[base + i];
+                    if (forward[i] && callbacks.live_at(base + i))
+                        cb(args...);
+                }
+            }
+        }
+
+        void clear() { callbacks.clear(); }
+
+        template<typename T>
+        connection_t attach(const extra_data_t extra, T t)
+        {
+            return this->insert_unique(extra, t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(const extra_data_t extra, T t, C c)
+        {
+            return this->insert_unique(extra, t, c);
+        }
+
+        void detach(connection_t connection)
+        {
+            callbacks.remove(connection);
+        }
+
+        template<typename T>
+        void detach(T t)
+        {
+            callbacks.remove(this->find_attached(t));
+        }
+
+        template<typename T, typename C>
+        void detach(T t, C c)
+        {
+            callbacks.remove(this->find_attached(t, c));
+        }
+
+        void can_forward_batch(const extra_data_t* extras, size_t count, bool* result, details::forward_t<Args>... args)
+        {
+            auto& self = *static_cast<derived_t*>(this);
+            for (size_t i = 0; i < count; i++)
+                result[i] = self.can_forward(extras[i], args...);
+        }
+
+    protected:
+        using typename store_t::callback_list_t;
+        using store_t::callbacks;
     };
 
 
+    /**
+     * option_traits
+     * -------------
+     *
+     * specialize this for an enum (or integer) option_t whose values all lie in
+     * [0, count) to have mapped_delegates keep its sub-delegates in a flat
+     * array indexed by the option value:
+     *
+     *    template<> struct creaky::option_traits<tile_event> {
+     *        static constexpr std::size_t count = size_t(tile_event::MAX);
+     *    };
+     *
+     */
+    template<typename option_t>
+    struct option_traits {};
+
+    namespace details
+    {
+        template<typename option_t, typename = void>
+        struct has_option_count : std::false_type {};
+
+        template<typename option_t>
+        struct has_option_count<option_t, std::void_t<decltype(option_traits<option_t>::count)>> : std::true_type {};
+
+        template<typename option_t>
+        inline std::size_t option_index(option_t opt)
+        {
+            typedef typename std::conditional<std::is_enum<option_t>::value,
+                std::underlying_type<option_t>, std::common_type<option_t>>::type::type integer_t;
+            return static_cast<std::size_t>(static_cast<integer_t>(opt));
+        }
+
+        /**
+         * the option storages below all expose the same small interface, used
+         * by mapped_delegates: find() returns nullptr when opt has no
+         * sub-delegates, get() creates them, and for_each() visits every
+         * existing (opt, sub-delegates) pair.  sub-delegates never move once
+         * created, so a handler may attach under a new option while another
+         * option is being forwarded.
+         */
+
+        // arbitrary option types: ordered tree, as before
+        template<typename option_t, typename inner_t>
+        class tree_option_storage
+        {
+        public:
+            size_t size() const { return items.size(); }
+            void clear() { items.clear(); }
+
+            inner_t* find(option_t opt)
+            {
+                auto it = items.find(opt);
+                return it != items.end() ? &it->second : nullptr;
+            }
+
+            inner_t& get(option_t opt) { return items[opt]; }
+            void erase(option_t opt) { items.erase(opt); }
+
+            template<typename F>
+            void for_each(F&& f)
+            {
+                for (auto& item : items)
+                    f(item.first, item.second);
+            }
+
+        protected:
+            std::map<option_t, inner_t> items;
+        };
+
+        // dense options with a declared range: one indexed load per dispatch
+        template<typename option_t, typename inner_t>
+        class flat_option_storage
+        {
+        public:
+            static constexpr std::size_t count = option_traits<option_t>::count;
+
+            flat_option_storage() : items(count), used(count, 0) {}
+
+            size_t size() const { return used_count; }
+
+            void clear()
+            {
+                for (std::size_t i = 0; i < count; i++)
+                    erase_at(i);
+            }
+
+            inner_t* find(option_t opt)
+            {
+                auto i = option_index(opt);
+                return (i < count && used[i]) ? &items[i] : nullptr;
+            }
+
+            inner_t& get(option_t opt)
+            {
+                auto i = option_index(opt);
+                assert(i < count && "option value outside of option_traits<>::count");
+                if (!used[i])
+                {
+                    used[i] = 1;
+                    ++used_count;
+                }
+                return items[i];
+            }
+
+            void erase(option_t opt)
+            {
+                auto i = option_index(opt);
+                if (i < count)
+                    erase_at(i);
+            }
+
+            template<typename F>
+            void for_each(F&& f)
+            {
+                for (std::size_t i = 0; i < count; i++)
+                    if (used[i])
+                        f(static_cast<option_t>(i), items[i]);
+            }
+
+        protected:
+            std::vector<inner_t> items;     // sized once, never reallocated
+            std::vector<std::uint8_t> used;
+            size_t used_count = 0;
+
+            void erase_at(std::size_t i)
+            {
+                if (!used[i])
+                    return;
+                items[i].clear();
+                used[i] = 0;
+                --used_count;
+            }
+        };
+
+        // integral/enum options with no declared range: open addressing, linear probing
+        template<typename option_t, typename inner_t>
+        class hashed_option_storage
+        {
+        public:
+            size_t size() const { return used_count; }
+
+            void clear()
+            {
+                table.clear();
+                used_count = 0;
+            }
+
+            inner_t* find(option_t opt)
+            {
+                if (table.empty())
+                    return nullptr;
+                for (auto i = home(opt); table[i].value; i = (i + 1) & mask())
+                    if (table[i].key == opt)
+                        return table[i].value.get();
+                return nullptr;
+            }
+
+            inner_t& get(option_t opt)
+            {
+                if (auto existing = find(opt))
+                    return *existing;
+
+                if ((used_count + 1) * 2 > table.size())
+                    grow();
+                auto i = home(opt);
+                while (table[i].value)
+                    i = (i + 1) & mask();
+                table[i].key = opt;
+                table[i].value.reset(new inner_t());
+                ++used_count;
+                return *table[i].value;
+            }
+
+            void erase(option_t opt)
+            {
+                if (table.empty())
+                    return;
+                auto i = home(opt);
+                while (table[i].value && !(table[i].key == opt))
+                    i = (i + 1) & mask();
+                if (!table[i].value)
+                    return;
+
+                // backward-shift deletion, so no tombstones are needed
+                table[i].value.reset();
+                --used_count;
+                for (auto j = (i + 1) & mask(); table[j].value; j = (j + 1) & mask())
+                {
+                    auto h = home(table[j].key);
+                    if (((j - h) & mask()) >= ((j - i) & mask()))
+                    {
+                        table[i] = std::move(table[j]);
+                        i = j;
+                    }
+                }
+            }
+
+            template<typename F>
+            void for_each(F&& f)
+            {
+                for (auto& entry : table)
+                    if (entry.value)
+                        f(entry.key, *entry.value);
+            }
+
+        protected:
+            // sub-delegates are boxed so that they keep their address across a grow()
+            struct entry_t
+            {
+                option_t key{};
+                std::unique_ptr<inner_t> value;
+            };
+
+            std::vector<entry_t> table;     // size is zero or a power of two
+            size_t used_count = 0;
+
+            std::size_t mask() const { return table.size() - 1; }
+
+            std::size_t home(option_t opt) const
+            {
+                // fibonacci hashing spreads sequential opcodes across the table
+                return static_cast<std::size_t>(std::uint64_t(option_index(opt)) * 0x9E3779B97F4A7C15ull >> 32) & mask();
+            }
+
+            void grow()
+            {
+                std::vector<entry_t> old(std::move(table));
+                table = std::vector<entry_t>(old.empty() ? 16 : old.size() * 2);
+                for (auto& entry : old)
+                {
+                    if (!entry.value)
+                        continue;
+                    auto i = home(entry.key);
+                    while (table[i].value)
+                        i = (i + 1) & mask();
+                    table[i] = std::move(entry);
+                }
+            }
+        };
+
+        template<typename option_t, typename inner_t>
+        struct select_option_storage
+        {
+            typedef typename std::conditional<has_option_count<option_t>::value,
+                flat_option_storage<option_t, inner_t>,
+                typename std::conditional<std::is_integral<option_t>::value || std::is_enum<option_t>::value,
+                    hashed_option_storage<option_t, inner_t>,
+                    tree_option_storage<option_t, inner_t>>::type>::type type;
+        };
+
+    } /// namespace details
+
+
     /**
      * mapped_delegates
      * ----------------
      *
      * this is meant to be used for interrupt-table style dispatching.  internally,
-     * there is a hash map container that matches option_t values with a basic_delegate.
-     * sub-delegates stored are wrapped around shared_ptr in order to obviate
-     * the need for a destructor.
+     * there is a container that matches option_t values with a basic_delegate.
+     * the container is picked at compile time from option_t:
+     *
+     *  - option_traits<option_t>::count declared: flat array indexed by value
+     *  - other integral or enum types: open-addressing hash table
+     *  - anything else: std::map
      *
      * aside from the delegate-standard operator(), a notify_all() method is also
-     * provided to forward calls to ALL the contained handlers.
+     * provided to forward calls to ALL the contained handlers.  it walks a
+     * flattened list of (sub-delegates, connection) pairs, rebuilt only after
+     * the handlers change, and calls the handlers in place.  with
+     * set_notify_unique(true), a handler attached under several options is
+     * called only once per notify_all().
      *
      */
     template<typename option_t, typename... Args>
     class mapped_delegates
     {
     public:
-        void notify_all(Args... args)
+        typedef typename basic_delegates<Args...>::callback_t callback_t;
+
+        void notify_all(details::forward_t<Args>... args)
         {
-            for (auto& cb : callbacks)
-                (cb.second)(args...);
+            if (broadcast_dirty && broadcast_depth == 0)
+                rebuild_broadcast();
+
+            broadcast_scope scope(*this);
+            for (size_t i = 0; i < broadcast.size() && !broadcast_cleared; )
+            {
+                // the entries of one sub-delegates are contiguous: they are walked as
+                // one of its own calls would, so none of them moves or goes away meanwhile
+                auto inner = broadcast[i].first;
+                auto& list = handlers_of(*inner);
+                typename inner_list_t::emit_scope inner_scope(list);
+                for (; i < broadcast.size() && broadcast[i].first == inner && !broadcast_cleared; i++)
+                {
+                    auto cb = list.get(broadcast[i].second);
+                    if (!cb || (broadcast_guarded && !reachable(i)))
+                        continue;
+                    (*cb)(args...);
+                    if (broadcast_guarded)
+                        settle(i);
+                }
+            }
         }
 
-        void operator()(option_t opt, Args... args)
+        void set_notify_unique(bool unique)
         {
-            auto it = callbacks.find(opt);
-            if (it != callbacks.end())
-                (*(it->second))(args...);
+            if (unique != broadcast_unique)
+            {
+                broadcast_unique = unique;
+                changed();
+            }
+        }
+
+        void operator()(option_t opt, details::forward_t<Args>... args)
+        {
+            if (auto target = callbacks.find(opt))
+            {
+                dispatch_scope scope(*this);
+                (*target)(args...);
+            }
         }
 
         size_t size() const { return callbacks.size(); }
-        void clear() { callbacks.clear(); };
+
+        /**
+         * while a call is going through the sub-delegates, they are only
+         * emptied: the options themselves are erased once the outermost
+         * call returns, unless something was attached to them meanwhile.
+         */
+        void clear()
+        {
+            if (broadcast_depth > 0)
+                broadcast_cleared = true;
+            changed();
+            if (dispatching())
+            {
+                callbacks.for_each([](option_t, inner_delegates_t& inner) { inner.clear(); });
+                sweep_all = true;
+                return;
+            }
+            callbacks.clear();
+        };
+
+        template<typename T>
+        connection_t attach(option_t opt, T t)
+        {
+            changed();
+            return get(opt).attach(t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(option_t opt, T t, C c)
+        {
+            changed();
+            return get(opt).attach(t, c);
+        }
+
+        template<auto method>
+        connection_t attach(option_t opt, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            changed();
+            return get(opt).template attach<method>(object);
+        }
+
+        // see basic_delegates::attach_tracked()
+        template<typename T, typename C>
+        connection_t attach_tracked(option_t opt, T t, C* c)
+        {
+            changed();
+            return get(opt).attach_tracked(t, c);
+        }
+
+        template<auto method>
+        connection_t attach_tracked(option_t opt, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            changed();
+            return get(opt).template attach_tracked<method>(object);
+        }
+
+        // see basic_delegates::attach_n().  notify_all() and operator() count
+        // against the same number of calls.
+        template<typename T>
+        connection_t attach_once(option_t opt, T t)
+        {
+            return attach_n(opt, 1, t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach_once(option_t opt, T t, C c)
+        {
+            return attach_n(opt, 1, t, c);
+        }
 
         template<typename T>
-        void attach(option_t opt, T t)
+        connection_t attach_n(option_t opt, std::uint32_t count, T t)
         {
-            auto target = get(opt);
-            target->second->attach(t);
+            changed();
+            return get(opt).attach_n(count, t);
         }
 
         template<typename T, typename C>
-        void attach(option_t opt, T t, C c)
+        connection_t attach_n(option_t opt, std::uint32_t count, T t, C c)
+        {
+            changed();
+            return get(opt).attach_n(count, t, c);
+        }
+
+        void detach(option_t opt, connection_t connection)
         {
-            auto target = get(opt);
-            target->second->attach(t, c);
+            if (auto target = callbacks.find(opt))
+            {
+                changed();
+                target->detach(connection);
+                erase_empty(opt, *target);
+            }
         }
 
         template<typename T>
         void detach(option_t opt, T t)
         {
-            auto target = callbacks.find(opt);
-            if (target != callbacks.end())
+            if (auto target = callbacks.find(opt))
             {
-                target->second->detach(t);
-#ifdef YAGLIB_DELEGATES_ERASE_EMPTY
-                if (target->second->size() == 0)
-                    callbacks.erase(target);
-#endif // YAGLIB_DELEGATES_ERASE_EMPTY  
+                changed();
+                target->detach(t);
+                erase_empty(opt, *target);
             }
         }
 
         template<typename T, typename C>
         void detach(option_t opt, T t, C c)
         {
-            auto target = callbacks.find(opt);
-            if (target != callbacks.end())
+            if (auto target = callbacks.find(opt))
             {
-                target->second->detach(t, c);
-#ifdef YAGLIB_DELEGATES_ERASE_EMPTY
-                if (target->second->size() == 0)
-                    callbacks.erase(target);
-#endif // YAGLIB_DELEGATES_ERASE_EMPTY  
+                changed();
+                target->detach(t, c);
+                erase_empty(opt, *target);
+            }
+        }
+
+        template<auto method>
+        void detach(option_t opt, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            if (auto target = callbacks.find(opt))
+            {
+                changed();
+                target->template detach<method>(object);
+                erase_empty(opt, *target);
             }
         }
 
     protected:
         typedef basic_delegates<Args...> inner_delegates_t;
-        typedef std::shared_ptr<inner_delegates_t> p_inner_delegates_t;
-        typedef std::map<option_t, p_inner_delegates_t> callback_list_t;
+        typedef details::handler_list<callback_t> inner_list_t;
+        typedef typename details::select_option_storage<option_t, inner_delegates_t>::type callback_list_t;
 
         callback_list_t callbacks;
 
         // this works as find(), except that when it does not find opt, it creates it and return that
-        auto get(option_t opt)
+        inner_delegates_t& get(option_t opt)
+        {
+            return callbacks.get(opt);
+        }
+
+        // flattened handlers for notify_all(), grouped by sub-delegates
+        std::vector<std::pair<inner_delegates_t*, connection_t>> broadcast;
+        std::uint32_t broadcast_depth = 0;
+        bool broadcast_dirty = true;
+        bool broadcast_stale = false;
+        bool broadcast_cleared = false;
+        bool broadcast_unique = false;
+        bool broadcast_guarded = false;     // some handler is tracked or has a limited number of calls
+
+        // options emptied during a call, erased once the outermost one returns
+        std::uint32_t dispatch_depth = 0;
+        std::vector<option_t> doomed;
+        bool sweep_all = false;
+
+        struct broadcast_scope
+        {
+            mapped_delegates& owner;
+            explicit broadcast_scope(mapped_delegates& owner) : owner(owner) { ++owner.broadcast_depth; }
+            ~broadcast_scope()
+            {
+                if (--owner.broadcast_depth == 0)
+                {
+                    owner.broadcast_stale = owner.broadcast_cleared = false;
+                    if (owner.dispatch_depth == 0)
+                        owner.sweep();
+                }
+            }
+        };
+
+        struct dispatch_scope
+        {
+            mapped_delegates& owner;
+            explicit dispatch_scope(mapped_delegates& owner) : owner(owner) { ++owner.dispatch_depth; }
+            ~dispatch_scope()
+            {
+                if (--owner.dispatch_depth == 0 && owner.broadcast_depth == 0)
+                    owner.sweep();
+            }
+        };
+
+        bool dispatching() const { return dispatch_depth > 0 || broadcast_depth > 0; }
+
+        void sweep()
+        {
+            if (sweep_all)
+            {
+                doomed.clear();
+                callbacks.for_each([&](option_t opt, inner_delegates_t&) { doomed.push_back(opt); });
+                sweep_all = false;
+            }
+            if (doomed.empty())
+                return;
+
+            for (auto& opt : doomed)
+            {
+                auto target = callbacks.find(opt);
+                if (target && target->size() == 0)
+                {
+                    changed();
+                    callbacks.erase(opt);
+                }
+            }
+            doomed.clear();
+        }
+
+        void changed()
+        {
+            broadcast_dirty = true;
+            if (broadcast_depth > 0)
+                broadcast_stale = true;
+        }
+
+        void rebuild_broadcast()
         {
-            auto target = callbacks.find(opt);
-            if (target == callbacks.end())
+            broadcast.clear();
+
+            std::unordered_set<details::handler_key_t, details::handler_key_hash> seen;
+            std::vector<const callback_t*> unkeyed;
+            bool emitting = false;
+            broadcast_guarded = false;
+            callbacks.for_each([&](option_t, inner_delegates_t& inner) {
+                auto& list = handlers_of(inner);
+                broadcast_guarded = broadcast_guarded || list.guarded();
+                emitting = emitting || list.emitting();
+                list.for_each_live([&](const callback_t& cb, const details::handler_key_t& key, connection_t connection) {
+                    if (broadcast_unique && is_duplicate(seen, unkeyed, cb, key))
+                        return;
+                    broadcast.emplace_back(&inner, connection);
+                });
+            });
+            // handlers attached to a sub-delegate during its own call are still
+            // pending in it, and only show up once it returns: rebuild again then
+            broadcast_dirty = emitting;
+        }
+
+        // false if the handler at i was detached, if its tracked object is gone
+        // (it is detached then), or if it has no call left
+        bool reachable(size_t i)
+        {
+            auto& owner = broadcast[i];
+            if (!owner.first->connected(owner.second))
+                return false;
+            auto& list = handlers_of(*owner.first);
+            if (list.expired(owner.second))
+            {
+                changed();
+                owner.first->detach(owner.second);
+                return false;
+            }
+            return list.take_shot(owner.second);
+        }
+
+        // detaches the handler at i once it made its last call
+        void settle(size_t i)
+        {
+            auto& owner = broadcast[i];
+            if (handlers_of(*owner.first).spent(owner.second))
             {
-                callbacks[opt] = p_inner_delegates_t(new inner_delegates_t());
-                target = callbacks.find(opt);
+                changed();
+                owner.first->detach(owner.second);
             }
-            return target;
+        }
+
+        // unkeyed handlers are compared by value with those already listed,
+        // which stay in place while the list is rebuilt
+        static bool is_duplicate(std::unordered_set<details::handler_key_t, details::handler_key_hash>& seen,
+            std::vector<const callback_t*>& unkeyed, const callback_t& cb, const details::handler_key_t& key)
+        {
+            if (key.keyed)
+                return !seen.insert(key).second;
+            for (auto listed : unkeyed)
+                if (*listed == cb)
+                    return true;
+            unkeyed.push_back(&cb);
+            return false;
+        }
+
+        void erase_empty(option_t opt, inner_delegates_t& target)
+        {
+#ifdef YAGLIB_DELEGATES_ERASE_EMPTY
+            // a call may be going through these very sub-delegates (or the broadcast list)
+            if (target.size() != 0)
+                return;
+            if (dispatching())
+                doomed.push_back(opt);
+            else
+                callbacks.erase(opt);
+#else
+            (void)opt;
+            (void)target;
+#endif // YAGLIB_DELEGATES_ERASE_EMPTY
         }
 
     };
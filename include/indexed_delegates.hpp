@@ -0,0 +1,412 @@
+#pragma once
+#ifndef __CREAKY_INDEXED_DELEGATES_T_H__
+#define __CREAKY_INDEXED_DELEGATES_T_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    /**
+     * indexed_parametric_delegates
+     * ----------------------------
+     *
+     * parametric delegates for the common case where the extra data is a small
+     * key (an entity type, a layer id...) and a handler should run only when
+     * it equals the key of the event.  instead of testing every handler on
+     * every call, handlers are bucketed by their extra value at attach time,
+     * using the same storage mapped_delegates picks for option_t, so a call
+     * only visits the handlers of the matching bucket.
+     *
+     * like parametric_delegates, a given handler can only be attached once,
+     * whatever its extra value, and detach() does not need the extra value.
+     * connections are numbered across buckets: detach(extra, connection)
+     * ignores a connection attached under another extra value.
+     *
+     * while a call is going through a bucket, clear() only empties the
+     * buckets, which are erased once the outermost call returns.
+     *
+     */
+    template<typename extra_data_t, typename... Args>
+    class indexed_parametric_delegates
+    {
+    public:
+        void operator()(const extra_data_t match, details::forward_t<Args>... args)
+        {
+            if (auto bucket = buckets.find(match))
+            {
+                dispatch_scope scope(*this);
+                (*bucket)(args...);
+            }
+        }
+
+        size_t size() const { return count; }
+
+        void clear()
+        {
+            for (std::uint32_t slot = 0; slot < handles.size(); slot++)
+                if (handles[slot].live)
+                    retire(slot);
+
+            if (dispatch_depth > 0)
+            {
+                buckets.for_each([](const extra_data_t, bucket_t& bucket) { bucket.clear(); });
+                sweep_all = true;
+                return;
+            }
+            buckets.clear();
+        }
+
+        // a handler that is already attached keeps its bucket, and its connection is returned
+        template<typename T>
+        connection_t attach(const extra_data_t extra, T t)
+        {
+            if (auto existing = find(t))
+                return existing;
+            auto& bucket = buckets.get(extra);
+            return enlist(extra, bucket, bucket.attach(t), details::key_of(t));
+        }
+
+        template<typename T, typename C>
+        connection_t attach(const extra_data_t extra, T t, C c)
+        {
+            if (auto existing = find(t, c))
+                return existing;
+            auto& bucket = buckets.get(extra);
+            return enlist(extra, bucket, bucket.attach(t, c), details::key_of(t, c));
+        }
+
+        void detach(const extra_data_t extra, connection_t connection)
+        {
+            auto handle = handle_of(connection);
+            if (handle && buckets.find(extra) == handle->bucket)
+                release(connection.index);
+        }
+
+        template<typename T>
+        void detach(T t)
+        {
+            static_assert(details::findable_v<callback_t, T>, "functors can only be detached through the connection_t returned by attach()");
+            if (auto connection = find(t))
+                release(connection.index);
+        }
+
+        template<typename T, typename C>
+        void detach(T t, C c)
+        {
+            if (auto connection = find(t, c))
+                release(connection.index);
+        }
+
+        bool connected(connection_t connection) const
+        {
+            return handle_of(connection) != nullptr;
+        }
+
+    protected:
+        typedef basic_delegates<Args...> bucket_t;
+        typedef typename bucket_t::callback_traits_t callback_traits_t;
+        typedef typename bucket_t::callback_t callback_t;
+        typedef typename details::select_option_storage<extra_data_t, bucket_t>::type bucket_list_t;
+
+        // what a connection of this container stands for: a handler in one of the buckets
+        struct handle_t
+        {
+            extra_data_t extra;
+            bucket_t* bucket;
+            connection_t inner;
+            details::handler_key_t key;
+            std::uint32_t generation;
+            bool live;
+        };
+
+        bucket_list_t buckets;
+        std::vector<handle_t> handles;
+        std::vector<std::uint32_t> free_handles;
+        std::unordered_map<details::handler_key_t, std::uint32_t, details::handler_key_hash> routes;    // keyed handlers, by handle
+        size_t count = 0;
+
+        // buckets emptied during a call, erased once the outermost one returns
+        std::uint32_t dispatch_depth = 0;
+        std::vector<extra_data_t> doomed;
+        bool sweep_all = false;
+
+        struct dispatch_scope
+        {
+            indexed_parametric_delegates& owner;
+            explicit dispatch_scope(indexed_parametric_delegates& owner) : owner(owner) { ++owner.dispatch_depth; }
+            ~dispatch_scope()
+            {
+                if (--owner.dispatch_depth == 0)
+                    owner.sweep();
+            }
+        };
+
+        const handle_t* handle_of(connection_t connection) const
+        {
+            if (connection.index >= handles.size())
+                return nullptr;
+            auto& handle = handles[connection.index];
+            return (handle.live && handle.generation == connection.generation) ? &handle : nullptr;
+        }
+
+        // the connection of an attached handler, whatever its bucket
+        template<typename T>
+        connection_t find(T t)
+        {
+            if constexpr (!details::findable_v<callback_t, T>)
+                return connection_t();
+            else
+                return find(details::key_of(t), [&](bucket_t& bucket) { return handlers_of(bucket).find(callback_t(t)); });
+        }
+
+        template<typename T, typename C>
+        connection_t find(T t, C c)
+        {
+            return find(details::key_of(t, c), [&](bucket_t& bucket) { return handlers_of(bucket).find(callback_traits_t::bind(t, c)); });
+        }
+
+        // keyed handlers have a route, anything else is looked for in every bucket
+        template<typename F>
+        connection_t find(const details::handler_key_t& key, F&& find_in)
+        {
+            if (key.keyed)
+            {
+                auto it = routes.find(key);
+                return it != routes.end() ? connection_t{ it->second, handles[it->second].generation } : connection_t();
+            }
+
+            connection_t found;
+            buckets.for_each([&](const extra_data_t, bucket_t& bucket) {
+                if (found)
+                    return;
+                if (auto inner = find_in(bucket))
+                    found = connection_of(&bucket, inner);
+            });
+            return found;
+        }
+
+        connection_t connection_of(const bucket_t* bucket, connection_t inner) const
+        {
+            for (std::uint32_t slot = 0; slot < handles.size(); slot++)
+                if (handles[slot].live && handles[slot].bucket == bucket && handles[slot].inner == inner)
+                    return connection_t{ slot, handles[slot].generation };
+            return connection_t();
+        }
+
+        connection_t enlist(const extra_data_t extra, bucket_t& bucket, connection_t inner, const details::handler_key_t& key)
+        {
+            std::uint32_t slot;
+            if (free_handles.empty())
+            {
+                slot = static_cast<std::uint32_t>(handles.size());
+                handles.push_back(handle_t{ extra, &bucket, inner, key, 0, true });
+            }
+            else
+            {
+                slot = free_handles.back();
+                free_handles.pop_back();
+                auto generation = handles[slot].generation;
+                handles[slot] = handle_t{ extra, &bucket, inner, key, generation, true };
+            }
+            if (key.keyed)
+                routes[key] = slot;
+            ++count;
+            return connection_t{ slot, handles[slot].generation };
+        }
+
+        // forgets the handle; the bucket entry is left to the caller
+        void retire(std::uint32_t slot)
+        {
+            auto& handle = handles[slot];
+            if (handle.key.keyed)
+                routes.erase(handle.key);
+            handle.live = false;
+            ++handle.generation;
+            free_handles.push_back(slot);
+            --count;
+        }
+
+        void release(std::uint32_t slot)
+        {
+            auto& handle = handles[slot];
+            handle.bucket->detach(handle.inner);
+            retire(slot);
+            erase_empty(handle.extra, *handle.bucket);
+        }
+
+        void erase_empty(const extra_data_t extra, bucket_t& bucket)
+        {
+#ifdef YAGLIB_DELEGATES_ERASE_EMPTY
+            // a call may be going through this very bucket
+            if (bucket.size() != 0)
+                return;
+            if (dispatch_depth > 0)
+                doomed.push_back(extra);
+            else
+                buckets.erase(extra);
+#else
+            (void)extra;
+            (void)bucket;
+#endif // YAGLIB_DELEGATES_ERASE_EMPTY
+        }
+
+        void sweep()
+        {
+            if (sweep_all)
+            {
+                doomed.clear();
+                buckets.for_each([&](const extra_data_t extra, bucket_t&) { doomed.push_back(extra); });
+                sweep_all = false;
+            }
+            for (auto& extra : doomed)
+            {
+                auto bucket = buckets.find(extra);
+                if (bucket && bucket->size() == 0)
+                    buckets.erase(extra);
+            }
+            doomed.clear();
+        }
+    };
+
+
+    /**
+     * bit_indexed_parametric_delegates
+     * --------------------------------
+     *
+     * the bitmask flavor: the extra data of each handler is a mask of the
+     * categories (physics layers, damage types...) it is interested in, and a
+     * call passes the mask of the event.  a handler runs when the two masks
+     * share at least one bit.
+     *
+     * handlers are listed under each bit of their mask at attach time, so a
+     * call only visits the buckets of the bits set in the event.  a handler
+     * matching several of those bits is still called once.  when the event
+     * has a single bit, handlers run in attach order; otherwise they run
+     * bucket by bucket, lowest bit first.
+     *
+     */
+    template<typename mask_t, typename... Args>
+    class bit_indexed_parametric_delegates : public details::handler_store<mask_t, Args...>
+    {
+        static_assert(std::is_unsigned<mask_t>::value, "bit_indexed_parametric_delegates needs an unsigned mask type");
+
+        typedef details::handler_store<mask_t, Args...> store_t;
+
+    public:
+        using typename store_t::callback_t;
+
+        static constexpr size_t bit_count = sizeof(mask_t) * 8;
+
+        void operator()(const mask_t event, details::forward_t<Args>... args)
+        {
+            typename callback_list_t::emit_scope scope(callbacks);
+            ++serial;
+            stamps.resize(callbacks.slot_count());
+
+            for (size_t bit = 0; bit < bit_count; bit++)
+            {
+                if (!((event >> bit) & 1))
+                    continue;
+
+                // indexed, not range-for: handlers attaching during the call append to the buckets
+                auto& bucket = buckets[bit];
+                for (size_t i = 0; i < bucket.size(); i++)
+                {
+                    auto connection = bucket[i];
+                    auto cb = callbacks.get(connection);
+                    if (!cb || !*cb || stamps[connection.index] == serial)
+                        continue;
+                    stamps[connection.index] = serial;
+                    (*cb)(args...);
+                }
+            }
+        }
+
+        void clear()
+        {
+            callbacks.clear();
+            for (auto& bucket : buckets)
+                bucket.clear();
+            stale = 0;
+        }
+
+        // a handler that is already attached keeps its buckets
+        template<typename T>
+        connection_t attach(const mask_t extra, T t)
+        {
+            auto key = details::key_of(t);
+            if (auto existing = this->find(key, t))
+                return existing;
+            return enlist(callbacks.insert(callback_t(t), key, extra), extra);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(const mask_t extra, T t, C c)
+        {
+            auto key = details::key_of(t, c);
+            if (auto existing = this->find(key, t, c))
+                return existing;
+            return enlist(callbacks.insert(this->cbx(t, c), key, extra), extra);
+        }
+
+        void detach(connection_t connection)
+        {
+            if (callbacks.remove(connection))
+                purge();
+        }
+
+        template<typename T>
+        void detach(T t)
+        {
+            detach(this->find_attached(t));
+        }
+
+        template<typename T, typename C>
+        void detach(T t, C c)
+        {
+            detach(this->find_attached(t, c));
+        }
+
+    protected:
+        using typename store_t::callback_list_t;
+        using store_t::callbacks;
+
+        std::vector<connection_t> buckets[bit_count];
+        std::vector<std::uint64_t> stamps;      // per slot: serial of the last call it ran in
+        std::uint64_t serial = 0;
+        size_t stale = 0;                       // detached handlers still listed in the buckets
+
+        connection_t enlist(connection_t connection, const mask_t extra)
+        {
+            for (size_t bit = 0; bit < bit_count; bit++)
+            {
+                if ((extra >> bit) & 1)
+                    buckets[bit].push_back(connection);
+            }
+            return connection;
+        }
+
+        // bucket entries of detached handlers are skipped when calling, and
+        // swept in bulk once there are more detached handlers than live ones
+        void purge()
+        {
+            ++stale;
+            if (callbacks.emitting() || stale <= callbacks.size())
+                return;
+
+            for (auto& bucket : buckets)
+                bucket.erase(std::remove_if(bucket.begin(), bucket.end(),
+                    [&](const connection_t& c) { return !callbacks.contains(c); }), bucket.end());
+            stale = 0;
+        }
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_INDEXED_DELEGATES_T_H__
@@ -0,0 +1,292 @@
+#pragma once
+#ifndef __CREAKY_MASK_DELEGATES_T_H__
+#define __CREAKY_MASK_DELEGATES_T_H__
+
+#include <algorithm>
+#include <cstdint>
+#include "delegates.hpp"
+
+// define YAGLIB_DELEGATES_NO_SIMD to always use the scalar mask matching
+#if !defined(YAGLIB_DELEGATES_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define YAGLIB_DELEGATES_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define YAGLIB_DELEGATES_NEON
+#include <arm_neon.h>
+#endif
+#endif // YAGLIB_DELEGATES_NO_SIMD
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace creaky
+{
+
+    /**
+     * mask128_t
+     * ---------
+     *
+     * 128-bit interest mask, for when 64 categories are not enough.
+     *
+     */
+    struct alignas(16) mask128_t
+    {
+        std::uint64_t low = 0;
+        std::uint64_t high = 0;
+
+        constexpr mask128_t() = default;
+        constexpr mask128_t(std::uint64_t low, std::uint64_t high = 0) : low(low), high(high) {}
+
+        static constexpr mask128_t bit(unsigned n)
+        {
+            return n < 64 ? mask128_t(std::uint64_t(1) << n, 0) : mask128_t(0, std::uint64_t(1) << (n - 64));
+        }
+
+        constexpr mask128_t operator&(const mask128_t& rhs) const { return mask128_t(low & rhs.low, high & rhs.high); }
+        constexpr mask128_t operator|(const mask128_t& rhs) const { return mask128_t(low | rhs.low, high | rhs.high); }
+        constexpr mask128_t operator~() const { return mask128_t(~low, ~high); }
+        mask128_t& operator&=(const mask128_t& rhs) { return *this = *this & rhs; }
+        mask128_t& operator|=(const mask128_t& rhs) { return *this = *this | rhs; }
+
+        constexpr bool operator==(const mask128_t& rhs) const { return low == rhs.low && high == rhs.high; }
+        constexpr bool operator!=(const mask128_t& rhs) const { return !(*this == rhs); }
+        constexpr explicit operator bool() const { return (low | high) != 0; }
+    };
+
+
+    namespace details
+    {
+        /**
+         * match_masks() tests up to 64 stored masks against an event mask and
+         * returns one bit per mask, set when they share a bit.  the generic
+         * version works for any unsigned integer (or mask128_t); the two
+         * supported widths have vector versions with SSE2 or NEON.
+         */
+        template<typename mask_t>
+        inline std::uint64_t match_masks(const mask_t* masks, size_t count, const mask_t& event)
+        {
+            std::uint64_t bits = 0;
+            for (size_t i = 0; i < count; i++)
+                bits |= std::uint64_t(bool(masks[i] & event)) << i;
+            return bits;
+        }
+
+#if defined(YAGLIB_DELEGATES_SSE2)
+        // two masks per register; a lane matched unless all of its bytes compare equal to zero
+        inline std::uint64_t match_masks(const std::uint64_t* masks, size_t count, const std::uint64_t& event)
+        {
+            const auto wanted = _mm_set1_epi64x(static_cast<long long>(event));
+            const auto zero = _mm_setzero_si128();
+            std::uint64_t bits = 0;
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                auto both = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + i)), wanted);
+                auto empty = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(both, zero)));
+                bits |= std::uint64_t((empty & 0xFF) != 0xFF) << i;
+                bits |= std::uint64_t((empty >> 8) != 0xFF) << (i + 1);
+            }
+            for (; i < count; i++)
+                bits |= std::uint64_t((masks[i] & event) != 0) << i;
+            return bits;
+        }
+
+        inline std::uint64_t match_masks(const mask128_t* masks, size_t count, const mask128_t& event)
+        {
+            const auto wanted = _mm_load_si128(reinterpret_cast<const __m128i*>(&event));
+            const auto zero = _mm_setzero_si128();
+            std::uint64_t bits = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                auto both = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(masks + i)), wanted);
+                bits |= std::uint64_t(_mm_movemask_epi8(_mm_cmpeq_epi8(both, zero)) != 0xFFFF) << i;
+            }
+            return bits;
+        }
+#elif defined(YAGLIB_DELEGATES_NEON)
+        // vtst sets a lane to all ones when the two share a bit
+        inline std::uint64_t match_masks(const std::uint64_t* masks, size_t count, const std::uint64_t& event)
+        {
+            const auto wanted = vdupq_n_u64(event);
+            std::uint64_t bits = 0;
+            size_t i = 0;
+            for (; i + 2 <= count; i += 2)
+            {
+                auto hits = vtstq_u64(vld1q_u64(masks + i), wanted);
+                bits |= (vgetq_lane_u64(hits, 0) & 1) << i;
+                bits |= (vgetq_lane_u64(hits, 1) & 1) << (i + 1);
+            }
+            for (; i < count; i++)
+                bits |= std::uint64_t((masks[i] & event) != 0) << i;
+            return bits;
+        }
+
+        inline std::uint64_t match_masks(const mask128_t* masks, size_t count, const mask128_t& event)
+        {
+            const auto wanted = vld1q_u64(&event.low);
+            std::uint64_t bits = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                auto hits = vtstq_u64(vld1q_u64(&masks[i].low), wanted);
+                bits |= ((vgetq_lane_u64(hits, 0) | vgetq_lane_u64(hits, 1)) & 1) << i;
+            }
+            return bits;
+        }
+#endif
+
+        // index of the lowest set bit; bits must not be zero
+        inline unsigned lowest_bit(std::uint64_t bits)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanForward64(&index, bits);
+            return static_cast<unsigned>(index);
+#else
+            return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+        }
+
+    } /// namespace details
+
+
+    /**
+     * mask_delegates
+     * --------------
+     *
+     * delegates for listeners interested in sets of event categories
+     * (physics layers, damage types...).  every handler is attached with an
+     * interest mask, and a call passes the mask of the event: only the
+     * handlers whose mask shares a bit with it are called, in attach order.
+     * mask_t is std::uint64_t or mask128_t (any unsigned integer works, but
+     * only those two are vectorized).
+     *
+     * the masks are kept contiguously in the handler list, apart from the
+     * callbacks, and a call matches them 64 at a time (SSE2 or NEON when
+     * available) into a bitset, then only visits the handlers whose bit is
+     * set.  a handler attached under several categories is a single entry,
+     * so it is called once however many bits match.
+     *
+     */
+    template<typename mask_t, typename... Args>
+    class mask_delegates : public details::handler_store<mask_t, Args...>
+    {
+        typedef details::handler_store<mask_t, Args...> store_t;
+
+    public:
+        using typename store_t::callback_t;
+
+        void operator()(const mask_t& event, details::forward_t<Args>... args)
+        {
+            typename callback_list_t::emit_scope scope(callbacks);
+            const auto count = callbacks.dense_size();
+            const bool guarded = callbacks.guarded();
+
+            for (size_t base = 0; base < count; base += 64)
+            {
+                auto bits = details::match_masks(callbacks.extras() + base, std::min<size_t>(64, count - base), event);
+                while (bits)
+                {
+                    auto i = base + details::lowest_bit(bits);
+                    bits &= bits - 1;
+
+                    // re-read the callback: handlers may detach others, but never move them
+                    auto& cb = callbacks.data()[i];
+                    if (!callbacks.live_at(i))
+                        continue;
+                    if (!guarded)
+                    {
+                        cb(args...);
+                        continue;
+                    }
+
+                    if (callbacks.expired(i))
+                    {
+                        callbacks.expire(i);
+                        continue;
+                    }
+                    if (!callbacks.take_shot(i))
+                        continue;
+                    cb(args...);
+                    if (callbacks.spent(i))
+                        callbacks.expire(i);
+                }
+            }
+        }
+
+        void clear() { callbacks.clear(); }
+
+        // a handler that is already attached keeps its mask, see set_mask()
+        template<typename T>
+        connection_t attach(const mask_t& mask, T t)
+        {
+            return this->insert_unique(mask, t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(const mask_t& mask, T t, C c)
+        {
+            return this->insert_unique(mask, t, c);
+        }
+
+        template<auto method>
+        connection_t attach(const mask_t& mask, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            auto key = details::key_of(method, object);
+            auto existing = callbacks.find(key);
+            if (existing)
+                return existing;
+            return callbacks.insert(store_t::callback_traits_t::template bind<method>(object), key, mask);
+        }
+
+        // see basic_delegates::attach_tracked()
+        template<typename T, typename C>
+        connection_t attach_tracked(const mask_t& mask, T t, C* c)
+        {
+            return this->insert_unique(mask, t, c, details::lifetime_of(c));
+        }
+
+        // changes the mask of an attached handler.  done during a call, it may
+        // already apply to the handlers that call has yet to match.
+        bool set_mask(connection_t connection, const mask_t& mask)
+        {
+            auto extra = callbacks.extra_of(connection);
+            if (!extra)
+                return false;
+            *extra = mask;
+            return true;
+        }
+
+        // the mask of an attached handler, or an empty one
+        mask_t mask_of(connection_t connection)
+        {
+            auto extra = callbacks.extra_of(connection);
+            return extra ? *extra : mask_t();
+        }
+
+        void detach(connection_t connection)
+        {
+            callbacks.remove(connection);
+        }
+
+        template<typename T>
+        void detach(T t)
+        {
+            callbacks.remove(this->find_attached(t));
+        }
+
+        template<typename T, typename C>
+        void detach(T t, C c)
+        {
+            callbacks.remove(this->find_attached(t, c));
+        }
+
+    protected:
+        using typename store_t::callback_list_t;
+        using store_t::callbacks;
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_MASK_DELEGATES_T_H__
@@ -0,0 +1,445 @@
+#pragma once
+#ifndef __CREAKY_PARALLEL_DELEGATES_T_H__
+#define __CREAKY_PARALLEL_DELEGATES_T_H__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    /**
+     * task_pool
+     * ---------
+     *
+     * small work-stealing thread pool.  every worker has its own queue: it
+     * takes work from the back of it, and when it runs dry steals from the
+     * front of the others.  a task is a function pointer plus two words,
+     * so submitting never allocates once the queues have grown.
+     *
+     * threads waiting for their tasks are expected to help (run_one())
+     * instead of blocking, which also makes it safe to wait from inside a
+     * task.
+     *
+     */
+    class task_pool
+    {
+    public:
+        struct task_t
+        {
+            void (*run)(void* context, size_t index);
+            void* context;
+            size_t index;
+        };
+
+        explicit task_pool(unsigned threads = default_threads())
+        {
+            threads = std::max(threads, 1u);
+            for (unsigned i = 0; i < threads; i++)
+                queues.emplace_back(new queue_t());
+            for (unsigned i = 0; i < threads; i++)
+                workers.emplace_back([this, i] { work(i); });
+        }
+
+        ~task_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(sleep_lock);
+                stopping = true;
+            }
+            wake.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        task_pool(const task_pool&) = delete;
+        task_pool& operator=(const task_pool&) = delete;
+
+        size_t size() const { return workers.size(); }
+
+        // tasks submitted from a worker go to its own queue, others are dealt round-robin
+        void submit(const task_t* tasks, size_t count)
+        {
+            if (count == 0)
+                return;
+
+            // counted under the queue lock once pushed, so that a worker seeing
+            // the counter finds the task, and take() never counts it down first
+            auto own = current() == this ? current_index() : npos;
+            for (size_t i = 0; i < count; i++)
+            {
+                auto target = own != npos ? own : next.fetch_add(1, std::memory_order_relaxed) % queues.size();
+                std::lock_guard<std::mutex> lock(queues[target]->lock);
+                queues[target]->tasks.push_back(tasks[i]);
+                queued.fetch_add(1);
+            }
+
+            // a worker about to sleep checks the counter under sleep_lock: taking it
+            // here makes sure it either saw the new tasks or is already waiting
+            {
+                std::lock_guard<std::mutex> lock(sleep_lock);
+            }
+            wake.notify_all();
+        }
+
+        // runs one waiting task, if there is any
+        bool run_one()
+        {
+            return run_one(current() == this ? current_index() : 0);
+        }
+
+        static task_pool& shared()
+        {
+            static task_pool pool;
+            return pool;
+        }
+
+        static unsigned default_threads()
+        {
+            auto cores = std::thread::hardware_concurrency();
+            return cores > 1 ? cores - 1 : 1;
+        }
+
+    private:
+        static constexpr size_t npos = ~size_t(0);
+
+        struct alignas(64) queue_t
+        {
+            std::mutex lock;
+            std::deque<task_t> tasks;
+        };
+
+        std::vector<std::unique_ptr<queue_t>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> queued{ 0 };
+        std::mutex sleep_lock;
+        std::condition_variable wake;
+        bool stopping = false;
+
+        // the pool (and queue) of the worker running on this thread, if any
+        static task_pool*& current()
+        {
+            static thread_local task_pool* pool = nullptr;
+            return pool;
+        }
+
+        static size_t& current_index()
+        {
+            static thread_local size_t index = 0;
+            return index;
+        }
+
+        void work(size_t self)
+        {
+            current() = this;
+            current_index() = self;
+            for (;;)
+            {
+                if (run_one(self))
+                    continue;
+
+                std::unique_lock<std::mutex> lock(sleep_lock);
+                wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+                if (stopping && queued.load() == 0)
+                    return;
+            }
+        }
+
+        bool run_one(size_t self)
+        {
+            task_t task;
+            if (!take(self, task))
+                return false;
+            task.run(task.context, task.index);
+            return true;
+        }
+
+        bool take(size_t self, task_t& task)
+        {
+            if (queued.load() == 0)
+                return false;
+
+            for (size_t i = 0; i < queues.size(); i++)
+            {
+                auto& queue = *queues[(self + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(queue.lock);
+                if (queue.tasks.empty())
+                    continue;
+
+                // own queue from the back (most recent, still warm), others from the front
+                if (i == 0)
+                {
+                    task = queue.tasks.back();
+                    queue.tasks.pop_back();
+                }
+                else
+                {
+                    task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                }
+                queued.fetch_sub(1);
+                return true;
+            }
+            return false;
+        }
+    };
+
+
+    namespace details
+    {
+        // shared state of one emit_parallel(), kept alive by its emit_token_t
+        struct parallel_job_t
+        {
+            std::atomic<size_t> remaining{ 0 };
+            std::mutex error_lock;
+            std::exception_ptr error;
+            task_pool* pool = nullptr;
+
+            virtual ~parallel_job_t() {}
+
+            void fail(std::exception_ptr e)
+            {
+                std::lock_guard<std::mutex> lock(error_lock);
+                if (!error)
+                    error = e;
+            }
+        };
+
+    } /// namespace details
+
+
+    /**
+     * emit_token_t
+     * ------------
+     *
+     * completion token of an emit_parallel().  wait() returns once every
+     * pooled handler has run, helping the pool meanwhile, and rethrows the
+     * first exception one of them threw.  a token that is still joinable
+     * waits when destroyed, since the handlers use arguments it owns.
+     *
+     */
+    class emit_token_t
+    {
+    public:
+        emit_token_t() = default;
+        explicit emit_token_t(std::shared_ptr<details::parallel_job_t> job) : job(std::move(job)) {}
+
+        emit_token_t(emit_token_t&&) = default;
+        emit_token_t& operator=(emit_token_t&& rhs)
+        {
+            if (this != &rhs)
+            {
+                join();
+                job = std::move(rhs.job);
+            }
+            return *this;
+        }
+
+        ~emit_token_t() { join(); }
+
+        bool joinable() const { return bool(job); }
+        bool done() const { return !job || job->remaining.load(std::memory_order_acquire) == 0; }
+
+        void wait()
+        {
+            if (!job)
+                return;
+            while (!done())
+            {
+                if (!job->pool->run_one())
+                    std::this_thread::yield();
+            }
+
+            auto finished = std::move(job);
+            if (finished->error)
+                std::rethrow_exception(finished->error);
+        }
+
+    private:
+        std::shared_ptr<details::parallel_job_t> job;
+
+        // like wait(), but never throws (destructor, reassignment)
+        void join()
+        {
+            try { wait(); }
+            catch (...) {}
+        }
+    };
+
+
+    // where a parallel_delegates handler runs on emit_parallel()
+    enum class affinity_t
+    {
+        pool,       // any worker of the pool
+        caller,     // the thread calling emit_parallel(), e.g. for engine calls
+    };
+
+
+    /**
+     * parallel_delegates
+     * ------------------
+     *
+     * delegates whose handlers may run concurrently.  operator() still calls
+     * them one after the other; emit_parallel() hands them out to a
+     * work-stealing task_pool (the shared one unless another is given) and
+     * returns at once with an emit_token_t to join.
+     *
+     * handlers attached with affinity_t::caller are run by emit_parallel()
+     * itself, in attach order, while the others run on the pool.  pooled
+     * handlers get their own copy of the arguments and of the handler list,
+     * so attach()/detach() are safe meanwhile (they take effect on the next
+     * emit), but whatever the handlers touch must be thread-safe.
+     *
+     * NOTE: a pooled handler runs on a copy of the attached callback, made
+     * for that emit_parallel() only.  a functor that changes its own captures
+     * (a mutable lambda counting its calls, say) never sees those changes
+     * again, neither on the next emit nor through operator(): keep such state
+     * behind a pointer or a reference.  caller handlers and operator() run
+     * the attached callback itself.
+     *
+     */
+    template<typename... Args>
+    class parallel_delegates : public details::handler_store<affinity_t, Args...>
+    {
+        typedef details::handler_store<affinity_t, Args...> store_t;
+
+    public:
+        using typename store_t::callback_t;
+
+        explicit parallel_delegates(task_pool& pool = task_pool::shared()) : pool(&pool) {}
+
+        void operator()(details::forward_t<Args>... args)
+        {
+            typename callback_list_t::emit_scope scope(callbacks);
+            for (size_t i = 0; i < callbacks.dense_size(); i++)
+                if (callbacks.live_at(i))
+                    callbacks.data()[i](args...);
+        }
+
+        emit_token_t emit_parallel(details::forward_t<Args>... args)
+        {
+            std::shared_ptr<job_t> job(new job_t(args...));
+            job->pool = pool;
+
+            typename callback_list_t::emit_scope scope(callbacks);
+            const auto count = callbacks.dense_size();
+            for (size_t i = 0; i < count; i++)
+            {
+                auto& cb = callbacks.data()[i];
+                if (callbacks.live_at(i) && callbacks.extras()[i] == affinity_t::pool)
+                    job->handlers.push_back(cb);
+            }
+
+            job->remaining.store(job->handlers.size());
+            tasks.clear();
+            for (size_t i = 0; i < job->handlers.size(); i++)
+                tasks.push_back(task_pool::task_t{ &job_t::run, job.get(), i });
+            pool->submit(tasks.data(), tasks.size());
+
+            // the token joins the pooled handlers even if one of these throws
+            emit_token_t token(std::move(job));
+            for (size_t i = 0; i < count; i++)
+            {
+                // re-read the callback: handlers may detach others, but never move them
+                auto& cb = callbacks.data()[i];
+                if (callbacks.live_at(i) && callbacks.extras()[i] == affinity_t::caller)
+                    cb(args...);
+            }
+            return token;
+        }
+
+        void clear() { callbacks.clear(); }
+
+        template<typename T>
+        connection_t attach(T t)
+        {
+            return attach(affinity_t::pool, t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(T t, C c)
+        {
+            return attach(affinity_t::pool, t, c);
+        }
+
+        template<typename T>
+        connection_t attach(affinity_t affinity, T t)
+        {
+            return this->insert_unique(affinity, t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach(affinity_t affinity, T t, C c)
+        {
+            return this->insert_unique(affinity, t, c);
+        }
+
+        void detach(connection_t connection)
+        {
+            callbacks.remove(connection);
+        }
+
+        template<typename T>
+        void detach(T t)
+        {
+            callbacks.remove(this->find_attached(t));
+        }
+
+        template<typename T, typename C>
+        void detach(T t, C c)
+        {
+            callbacks.remove(this->find_attached(t, c));
+        }
+
+    protected:
+        using typename store_t::callback_list_t;
+        using store_t::callbacks;
+
+        struct job_t : details::parallel_job_t
+        {
+            std::tuple<typename std::decay<Args>::type...> arguments;
+            std::vector<callback_t> handlers;     // copies, see the class comment
+
+            explicit job_t(details::forward_t<Args>... args) : arguments(args...) {}
+
+            static void run(void* context, size_t index)
+            {
+                auto& self = *static_cast<job_t*>(context);
+                try
+                {
+                    self.call(self.handlers[index], std::index_sequence_for<Args...>());
+                }
+                catch (...)
+                {
+                    self.fail(std::current_exception());
+                }
+                // last access: the token may free the job as soon as this hits 0
+                self.remaining.fetch_sub(1, std::memory_order_release);
+            }
+
+            template<size_t... I>
+            void call(const callback_t& cb, std::index_sequence<I...>)
+            {
+                cb(std::get<I>(arguments)...);
+            }
+        };
+
+        task_pool* pool;
+        std::vector<task_pool::task_t> tasks;
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_PARALLEL_DELEGATES_T_H__
@@ -0,0 +1,292 @@
+#pragma once
+#ifndef __CREAKY_QUEUED_DELEGATES_T_H__
+#define __CREAKY_QUEUED_DELEGATES_T_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    /**
+     * queue_stats_t
+     * -------------
+     *
+     * counters of a queued_delegates, since it was built or last reset.
+     *
+     */
+    struct queue_stats_t
+    {
+        std::uint64_t posted = 0;       // events accepted by post()
+        std::uint64_t dropped = 0;      // events refused by post() because the queue was full
+        std::uint64_t coalesced = 0;    // events superseded by a later one with the same key
+        std::uint64_t drained = 0;      // events forwarded to the handlers
+        size_t high_water = 0;          // most events waiting at once
+    };
+
+
+    /**
+     * queued_delegates
+     * ----------------
+     *
+     * basic_delegates fed from other threads.  any number of threads may
+     * post() events into a bounded lock-free ring; one thread (the main
+     * thread, typically once per _process) drain()s them into the handlers.
+     * attach()/detach() are those of basic_delegates, and belong to the
+     * draining thread as well.
+     *
+     * the ring never grows: post() returns false and counts the event as
+     * dropped when it is full, and stats() tells how close to that it came.
+     *
+     * with coalesce_by(key), a drain forwards only the last event of each
+     * key among the ones it takes (e.g. the latest position of each unit),
+     * at the place of that last event.
+     *
+     * events posted by handlers during a drain wait for the next one, and
+     * a drain() called from a handler does nothing.
+     *
+     */
+    template<typename... Args>
+    class queued_delegates : basic_delegates<Args...>
+    {
+        typedef basic_delegates<Args...> base_t;
+
+    public:
+        typedef std::tuple<typename std::decay<Args>::type...> event_t;
+        typedef ::delegate<std::uint64_t(const typename std::decay<Args>::type&...)> key_t;
+
+        using typename base_t::callback_traits_t;
+        using typename base_t::callback_t;
+        using base_t::size;
+        using base_t::clear;
+        using base_t::attach;
+        using base_t::attach_tracked;
+        using base_t::attach_once;
+        using base_t::attach_n;
+        using base_t::detach;
+        using base_t::connected;
+
+        // capacity is rounded up to a power of two
+        explicit queued_delegates(size_t capacity = 1024)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+            cells.reset(new cell_t[size]);
+            mask = size - 1;
+            for (size_t i = 0; i < size; i++)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        ~queued_delegates()
+        {
+            discard();
+        }
+
+        queued_delegates(const queued_delegates&) = delete;
+        queued_delegates& operator=(const queued_delegates&) = delete;
+
+        // thread-safe.  false if the queue is full, the event is then dropped.
+        bool post(details::forward_t<Args>... args)
+        {
+            auto position = tail.load(std::memory_order_relaxed);
+            cell_t* cell;
+            for (;;)
+            {
+                cell = &cells[position & mask];
+                auto sequence = cell->sequence.load(std::memory_order_acquire);
+                auto lag = std::intptr_t(sequence) - std::intptr_t(position);
+                if (lag == 0)
+                {
+                    if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (lag < 0)
+                {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                else
+                    position = tail.load(std::memory_order_relaxed);
+            }
+
+            new (cell->storage) event_t(args...);
+            cell->sequence.store(position + 1, std::memory_order_release);
+
+            posted.fetch_add(1, std::memory_order_relaxed);
+            // the draining thread may have moved head past this event already
+            auto depth = std::intptr_t(position + 1 - head.load(std::memory_order_relaxed));
+            if (depth <= 0)
+                return true;
+            auto mark = high_water.load(std::memory_order_relaxed);
+            while (size_t(depth) > mark && !high_water.compare_exchange_weak(mark, size_t(depth), std::memory_order_relaxed)) {}
+            return true;
+        }
+
+        /**
+         * forwards up to max waiting events to the handlers, in post order,
+         * and returns how many were forwarded.  draining thread only.
+         */
+        size_t drain(size_t max = ~size_t(0))
+        {
+            if (draining)
+                return 0;
+            drain_guard guard(*this);
+
+            while (batch.size() < max && pop([&](event_t&& event) { batch.push_back(std::move(event)); })) {}
+            if (key)
+                coalesce();
+            else
+                superseded.clear();
+
+            size_t count = 0;
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                if (superseded.empty() || !superseded[i])
+                {
+                    forward(batch[i], std::index_sequence_for<Args...>());
+                    ++count;
+                }
+            }
+            drained_count.fetch_add(count, std::memory_order_relaxed);
+            return count;
+        }
+
+        // drops every waiting event.  draining thread only.
+        void discard()
+        {
+            while (pop([](event_t&&) {})) {}
+        }
+
+        // approximate number of waiting events
+        size_t pending() const
+        {
+            // both ends move meanwhile: head may be read past the tail that was read
+            auto depth = std::intptr_t(tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed));
+            return depth > 0 ? size_t(depth) : 0;
+        }
+
+        size_t capacity() const { return mask + 1; }
+
+        template<typename K>
+        void coalesce_by(K k)
+        {
+            key = key_t(k);
+        }
+
+        void coalesce_off() { key = key_t(); }
+
+        queue_stats_t stats() const
+        {
+            queue_stats_t result;
+            result.posted = posted.load(std::memory_order_relaxed);
+            result.dropped = dropped.load(std::memory_order_relaxed);
+            result.coalesced = coalesced_count.load(std::memory_order_relaxed);
+            result.drained = drained_count.load(std::memory_order_relaxed);
+            result.high_water = high_water.load(std::memory_order_relaxed);
+            return result;
+        }
+
+        void reset_stats()
+        {
+            posted.store(0, std::memory_order_relaxed);
+            dropped.store(0, std::memory_order_relaxed);
+            high_water.store(0, std::memory_order_relaxed);
+            coalesced_count.store(0, std::memory_order_relaxed);
+            drained_count.store(0, std::memory_order_relaxed);
+        }
+
+    protected:
+        // one slot of the ring: the sequence tells whose turn it is (producers
+        // wait for position, the consumer for position + 1)
+        struct cell_t
+        {
+            std::atomic<size_t> sequence;
+            alignas(event_t) unsigned char storage[sizeof(event_t)];
+        };
+
+        std::unique_ptr<cell_t[]> cells;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> tail{ 0 };
+        alignas(64) std::atomic<size_t> head{ 0 };
+        alignas(64) std::atomic<std::uint64_t> posted{ 0 };
+        std::atomic<std::uint64_t> dropped{ 0 };
+        std::atomic<size_t> high_water{ 0 };
+
+        // consumer side; the counters are atomic for stats() only
+        std::atomic<std::uint64_t> coalesced_count{ 0 };
+        std::atomic<std::uint64_t> drained_count{ 0 };
+        bool draining = false;
+        key_t key;
+        std::vector<event_t> batch;
+        std::vector<bool> superseded;
+        std::unordered_map<std::uint64_t, size_t> latest;
+
+        struct drain_guard
+        {
+            queued_delegates& owner;
+            explicit drain_guard(queued_delegates& owner) : owner(owner) { owner.draining = true; }
+            ~drain_guard()
+            {
+                owner.batch.clear();
+                owner.draining = false;
+            }
+        };
+
+        // hands the oldest event to take as an rvalue, so event_t needs no default constructor
+        template<typename F>
+        bool pop(F&& take)
+        {
+            auto position = head.load(std::memory_order_relaxed);
+            auto& cell = cells[position & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != position + 1)
+                return false;
+
+            auto stored = std::launder(reinterpret_cast<event_t*>(cell.storage));
+            take(std::move(*stored));
+            stored->~event_t();
+            cell.sequence.store(position + mask + 1, std::memory_order_release);
+            head.store(position + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        void coalesce()
+        {
+            superseded.assign(batch.size(), false);
+            latest.clear();
+            for (size_t i = 0; i < batch.size(); i++)
+            {
+                auto it = latest.emplace(call_key(batch[i], std::index_sequence_for<Args...>()), i);
+                if (!it.second)
+                {
+                    superseded[it.first->second] = true;
+                    it.first->second = i;
+                    coalesced_count.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        template<size_t... I>
+        std::uint64_t call_key(const event_t& event, std::index_sequence<I...>)
+        {
+            return key(std::get<I>(event)...);
+        }
+
+        template<size_t... I>
+        void forward(const event_t& event, std::index_sequence<I...>)
+        {
+            base_t::operator()(std::get<I>(event)...);
+        }
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_QUEUED_DELEGATES_T_H__
@@ -0,0 +1,436 @@
+#pragma once
+#ifndef __CREAKY_TOPIC_DELEGATES_T_H__
+#define __CREAKY_TOPIC_DELEGATES_T_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "delegates.hpp"
+
+namespace creaky
+{
+
+    namespace details
+    {
+        /**
+         * interns the segments of dotted paths ("unit.42.damaged"), so that
+         * paths are compared as short arrays of integers.  the two wildcards
+         * get fixed ids.  names are kept in a deque, whose strings never move,
+         * and looked up by string_view, so interning a known segment does not
+         * build a string.
+         */
+        class segment_table
+        {
+        public:
+            typedef std::uint32_t segment_t;
+            typedef std::vector<segment_t> path_t;
+
+            static constexpr segment_t any_one = 0;     // "*": exactly one segment
+            static constexpr segment_t any_tail = 1;    // "#", last: zero or more segments
+
+            segment_table()
+            {
+                ids.emplace("*", any_one);
+                ids.emplace("#", any_tail);
+            }
+
+            // the ids view names: moving keeps the strings where they are, copying would not
+            segment_table(const segment_table&) = delete;
+            segment_table& operator=(const segment_table&) = delete;
+            segment_table(segment_table&&) = default;
+            segment_table& operator=(segment_table&&) = default;
+
+            path_t split(std::string_view path)
+            {
+                path_t result;
+                size_t start = 0;
+                for (;;)
+                {
+                    auto end = path.find('.', start);
+                    result.push_back(intern(path.substr(start, end == std::string_view::npos ? end : end - start)));
+                    if (end == std::string_view::npos)
+                        return result;
+                    start = end + 1;
+                }
+            }
+
+            // true if the concrete path matches the pattern
+            static bool matches(const path_t& pattern, const path_t& path)
+            {
+                for (size_t i = 0; i < pattern.size(); i++)
+                {
+                    if (pattern[i] == any_tail && i + 1 == pattern.size())
+                        return true;
+                    if (i == path.size() || (pattern[i] != any_one && pattern[i] != path[i]))
+                        return false;
+                }
+                return pattern.size() == path.size();
+            }
+
+        private:
+            std::deque<std::string> names;
+            std::unordered_map<std::string_view, segment_t> ids;
+
+            segment_t intern(std::string_view segment)
+            {
+                auto existing = ids.find(segment);
+                if (existing != ids.end())
+                    return existing->second;
+                names.emplace_back(segment);
+                return ids.emplace(names.back(), segment_t(ids.size())).first->second;
+            }
+        };
+
+    } /// namespace details
+
+
+    /**
+     * topic_delegates
+     * ---------------
+     *
+     * mapped_delegates for dotted topics with wildcards.  handlers attach
+     * under a pattern, calls are made on a concrete topic:
+     *
+     *    d.attach("unit.*.damaged", &on_damage);   // "*" matches one segment
+     *    d.attach("unit.#", &on_any_unit);         // "#", last, matches zero or more
+     *    d("unit.42.damaged", 10);
+     *
+     * segments are interned and patterns kept in a trie.  every topic
+     * caches the list of patterns matching it: it is resolved through the
+     * trie when the topic is first seen, then kept up to date as patterns
+     * gain their first handler or lose their last one, so a call is a single
+     * lookup.  topic() interns a topic once and returns a handle; calling
+     * with the handle skips hashing the string as well.
+     *
+     * each pattern holds a basic_delegates (priorities, tracking and counted
+     * handlers work as usual within it), and a call goes through the
+     * matching patterns in the order they were first attached to.  patterns
+     * and topics are never forgotten, so handles stay valid; a pattern
+     * without handlers only costs its trie node.  a pattern whose handlers
+     * are all spent or whose objects are all gone stays listed (and is
+     * called, for nothing) until something is attached or detached under it.
+     *
+     */
+    template<typename... Args>
+    class topic_delegates
+    {
+    public:
+        typedef typename basic_delegates<Args...>::callback_t callback_t;
+        typedef std::uint32_t topic_t;
+
+        // interns a concrete topic
+        topic_t topic(std::string_view path)
+        {
+            auto existing = topic_ids.find(path);
+            if (existing != topic_ids.end())
+                return existing->second;
+
+            auto id = topic_t(topics.size());
+            topics.emplace_back();
+            topics.back().path = segments.split(path);
+            resolve(topics.back());
+            topic_names.emplace_back(path);
+            topic_ids.emplace(topic_names.back(), id);
+            return id;
+        }
+
+        void operator()(topic_t id, details::forward_t<Args>... args)
+        {
+            dispatch_scope scope(*this);
+            // by index: handlers may intern topics (topics grows) or attach new patterns (lists are only synced after)
+            for (size_t i = 0; i < topics[id].resolved.size(); i++)
+                (*topics[id].resolved[i].handlers)(args...);
+        }
+
+        void operator()(std::string_view path, details::forward_t<Args>... args)
+        {
+            (*this)(topic(path), args...);
+        }
+
+        // number of patterns with handlers
+        size_t size() const { return listed_count; }
+
+        void clear()
+        {
+            for (size_t i = 1; i < patterns.size(); i++)
+            {
+                if (patterns[i].handlers)
+                {
+                    patterns[i].handlers->clear();
+                    sync(pattern_t(i));
+                }
+            }
+        }
+
+        template<typename T>
+        connection_t attach(std::string_view pattern, T t)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.attach(t); });
+        }
+
+        template<typename T, typename C>
+        connection_t attach(std::string_view pattern, T t, C c)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.attach(t, c); });
+        }
+
+        template<auto method>
+        connection_t attach(std::string_view pattern, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.template attach<method>(object); });
+        }
+
+        // see basic_delegates::attach_tracked()
+        template<typename T, typename C>
+        connection_t attach_tracked(std::string_view pattern, T t, C* c)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.attach_tracked(t, c); });
+        }
+
+        template<auto method>
+        connection_t attach_tracked(std::string_view pattern, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.template attach_tracked<method>(object); });
+        }
+
+        // see basic_delegates::attach_n()
+        template<typename T>
+        connection_t attach_once(std::string_view pattern, T t)
+        {
+            return attach_n(pattern, 1, t);
+        }
+
+        template<typename T, typename C>
+        connection_t attach_once(std::string_view pattern, T t, C c)
+        {
+            return attach_n(pattern, 1, t, c);
+        }
+
+        template<typename T>
+        connection_t attach_n(std::string_view pattern, std::uint32_t count, T t)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.attach_n(count, t); });
+        }
+
+        template<typename T, typename C>
+        connection_t attach_n(std::string_view pattern, std::uint32_t count, T t, C c)
+        {
+            return subscribe(pattern, [&](inner_delegates_t& inner) { return inner.attach_n(count, t, c); });
+        }
+
+        void detach(std::string_view pattern, connection_t connection)
+        {
+            unsubscribe(pattern, [&](inner_delegates_t& inner) { inner.detach(connection); });
+        }
+
+        template<typename T>
+        void detach(std::string_view pattern, T t)
+        {
+            unsubscribe(pattern, [&](inner_delegates_t& inner) { inner.detach(t); });
+        }
+
+        template<typename T, typename C>
+        void detach(std::string_view pattern, T t, C c)
+        {
+            unsubscribe(pattern, [&](inner_delegates_t& inner) { inner.detach(t, c); });
+        }
+
+        template<auto method>
+        void detach(std::string_view pattern, typename details::method_traits<decltype(method)>::class_t* object)
+        {
+            unsubscribe(pattern, [&](inner_delegates_t& inner) { inner.template detach<method>(object); });
+        }
+
+    protected:
+        typedef basic_delegates<Args...> inner_delegates_t;
+        typedef details::segment_table::segment_t segment_t;
+        typedef details::segment_table::path_t path_t;
+        typedef std::uint32_t pattern_t;
+
+        // trie node; the ones ending a pattern own its handlers (boxed, so that
+        // the cached lists can point at them whatever happens to the trie)
+        struct pattern_node_t
+        {
+            std::unordered_map<segment_t, pattern_t> children;
+            std::unique_ptr<inner_delegates_t> handlers;
+            path_t path;
+            std::uint32_t order = 0;    // rank of its first attach: patterns are called in that order
+            bool listed = false;        // in the lists of the topics it matches
+        };
+
+        struct resolved_t
+        {
+            pattern_t pattern;
+            std::uint32_t order;
+            inner_delegates_t* handlers;
+
+            bool operator<(const resolved_t& rhs) const { return order < rhs.order; }
+        };
+
+        struct topic_entry_t
+        {
+            path_t path;
+            std::vector<resolved_t> resolved;   // matching listed patterns, by first attach
+        };
+
+        details::segment_table segments;
+        std::vector<pattern_node_t> patterns = std::vector<pattern_node_t>(1);      // [0] is the root
+        std::vector<topic_entry_t> topics;
+        std::deque<std::string> topic_names;       // never move, topic_ids views them
+        std::unordered_map<std::string_view, topic_t> topic_ids;
+        size_t listed_count = 0;
+        std::uint32_t next_order = 0;
+
+        // patterns whose handlers changed during a call, synced once it returns
+        std::vector<pattern_t> unsynced;
+        std::uint32_t dispatch_depth = 0;
+
+        struct dispatch_scope
+        {
+            topic_delegates& owner;
+            explicit dispatch_scope(topic_delegates& owner) : owner(owner) { ++owner.dispatch_depth; }
+            ~dispatch_scope()
+            {
+                if (--owner.dispatch_depth == 0 && !owner.unsynced.empty())
+                {
+                    std::vector<pattern_t> pending;
+                    pending.swap(owner.unsynced);
+                    for (auto id : pending)
+                        owner.sync(id);
+                }
+            }
+        };
+
+        // finds the node ending pattern, creating it (and the path to it) if needed
+        pattern_t node_of(std::string_view pattern)
+        {
+            auto path = segments.split(pattern);
+            pattern_t id = 0;
+            for (auto segment : path)
+            {
+                auto it = patterns[id].children.find(segment);
+                if (it != patterns[id].children.end())
+                {
+                    id = it->second;
+                    continue;
+                }
+                auto child = pattern_t(patterns.size());
+                patterns[id].children.emplace(segment, child);
+                patterns.emplace_back();
+                id = child;
+            }
+            if (!patterns[id].handlers)
+            {
+                patterns[id].handlers.reset(new inner_delegates_t());
+                patterns[id].path = std::move(path);
+                patterns[id].order = next_order++;
+            }
+            return id;
+        }
+
+        template<typename F>
+        connection_t subscribe(std::string_view pattern, F&& f)
+        {
+            auto id = node_of(pattern);
+            auto connection = f(*patterns[id].handlers);
+            sync(id);
+            return connection;
+        }
+
+        template<typename F>
+        void unsubscribe(std::string_view pattern, F&& f)
+        {
+            // detaching must not grow the trie
+            pattern_t id = 0;
+            for (auto segment : segments.split(pattern))
+            {
+                auto it = patterns[id].children.find(segment);
+                if (it == patterns[id].children.end())
+                    return;
+                id = it->second;
+            }
+            if (!patterns[id].handlers)
+                return;
+            f(*patterns[id].handlers);
+            sync(id);
+        }
+
+        // adds the pattern to, or removes it from, the lists of the topics it matches
+        void sync(pattern_t id)
+        {
+            if (dispatch_depth > 0)
+            {
+                unsynced.push_back(id);
+                return;
+            }
+
+            auto& node = patterns[id];
+            bool wanted = node.handlers->size() > 0;
+            if (wanted == node.listed)
+                return;
+
+            node.listed = wanted;
+            if (wanted)
+                ++listed_count;
+            else
+                --listed_count;
+            resolved_t entry{ id, node.order, node.handlers.get() };
+            for (auto& topic : topics)
+            {
+                if (!details::segment_table::matches(node.path, topic.path))
+                    continue;
+                auto at = std::lower_bound(topic.resolved.begin(), topic.resolved.end(), entry);
+                if (wanted)
+                    topic.resolved.insert(at, entry);
+                else
+                    topic.resolved.erase(at);
+            }
+        }
+
+        void resolve(topic_entry_t& topic)
+        {
+            collect(0, topic.path, 0, topic.resolved);
+            std::sort(topic.resolved.begin(), topic.resolved.end());
+            // a topic holding a "#" segment reaches the "#" node both ways
+            topic.resolved.erase(std::unique(topic.resolved.begin(), topic.resolved.end(),
+                [](const resolved_t& a, const resolved_t& b) { return a.pattern == b.pattern; }), topic.resolved.end());
+        }
+
+        void collect(pattern_t id, const path_t& path, size_t depth, std::vector<resolved_t>& out)
+        {
+            auto& node = patterns[id];
+            auto tail = node.children.find(details::segment_table::any_tail);
+            if (tail != node.children.end() && patterns[tail->second].listed)
+            {
+                auto& any_tail = patterns[tail->second];
+                out.push_back(resolved_t{ tail->second, any_tail.order, any_tail.handlers.get() });
+            }
+
+            if (depth == path.size())
+            {
+                if (node.listed)
+                    out.push_back(resolved_t{ id, node.order, node.handlers.get() });
+                return;
+            }
+
+            auto exact = node.children.find(path[depth]);
+            if (exact != node.children.end())
+                collect(exact->second, path, depth + 1, out);
+            if (path[depth] != details::segment_table::any_one)
+            {
+                auto any = node.children.find(details::segment_table::any_one);
+                if (any != node.children.end())
+                    collect(any->second, path, depth + 1, out);
+            }
+        }
+    };
+
+} /// namespace creaky
+
+#endif /// __CREAKY_TOPIC_DELEGATES_T_H__
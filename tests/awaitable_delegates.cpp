@@ -0,0 +1,104 @@
+#include "test.hpp"
+#include <stdexcept>
+#include <string>
+#include "awaitable_delegates.hpp"
+
+#ifdef YAGLIB_DELEGATES_HAS_COROUTINES
+
+using namespace creaky;
+
+namespace
+{
+    // eager coroutine, destroyed with its task; exceptions reach the resumer
+    struct task_t
+    {
+        struct promise_type
+        {
+            task_t get_return_object() { return task_t(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { throw; }
+        };
+
+        std::coroutine_handle<promise_type> handle;
+
+        explicit task_t(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+        task_t(task_t&& rhs) noexcept : handle(rhs.handle) { rhs.handle = nullptr; }
+        ~task_t() { if (handle) handle.destroy(); }
+    };
+
+    std::string trace;
+
+    task_t watch(awaitable_delegates<int, std::string>& d, const char* name, int times)
+    {
+        for (int i = 0; i < times; i++)
+        {
+            auto [x, text] = co_await d.next();
+            trace += name + std::to_string(x) + text + " ";
+        }
+    }
+
+    task_t explode(awaitable_delegates<int, std::string>& d)
+    {
+        co_await d.next();
+        throw std::runtime_error("resumed coroutine failed");
+    }
+
+    void handler(int x, std::string) { trace += "h" + std::to_string(x) + " "; }
+}
+
+static_assert(!std::is_convertible<awaitable_delegates<int>*, basic_delegates<int>*>::value,
+    "awaitable_delegates must not be usable as a basic_delegates");
+
+TEST_CASE(awaitable_resumes_after_handlers)
+{
+    awaitable_delegates<int, std::string> d;
+    d.attach(&handler);
+    trace.clear();
+    auto a = watch(d, "a", 2);
+    auto b = watch(d, "b", 1);
+    CHECK(d.waiting() == 2);
+
+    d(1, "x");
+    CHECK(trace == "h1 a1x b1x ");
+    CHECK(d.waiting() == 1);
+
+    // destroyed while waiting: unlinks itself
+    {
+        auto c = watch(d, "c", 1);
+        CHECK(d.waiting() == 2);
+    }
+    CHECK(d.waiting() == 1);
+
+    trace.clear();
+    d(2, "y");
+    CHECK(trace == "h2 a2y ");
+    CHECK(d.waiting() == 0);
+}
+
+TEST_CASE(awaitable_keeps_waiters_when_a_resume_throws)
+{
+    awaitable_delegates<int, std::string> d;
+    trace.clear();
+    auto a = watch(d, "a", 1);
+    auto bad = explode(d);
+    auto b = watch(d, "b", 1);
+    auto later = watch(d, "z", 1);
+    CHECK(d.waiting() == 4);
+
+    bool thrown = false;
+    try { d(1, "x"); }
+    catch (const std::runtime_error&) { thrown = true; }
+    CHECK(thrown);
+    CHECK(trace == "a1x ");
+    CHECK(d.waiting() == 2);
+
+    // the waiters not woken are still linked, in their order
+    trace.clear();
+    d(2, "y");
+    CHECK(trace == "b2y z2y ");
+    CHECK(d.waiting() == 0);
+}
+
+#endif // YAGLIB_DELEGATES_HAS_COROUTINES
@@ -0,0 +1,240 @@
+#include "test.hpp"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::string trace;
+
+    void first(int v) { trace += "a" + std::to_string(v); }
+    void second(int v) { trace += "b" + std::to_string(v); }
+    void third(int v) { trace += "c" + std::to_string(v); }
+
+    struct counter_t
+    {
+        int total = 0;
+        void add(int v) { total += v; }
+        void twice(int v) { total += 2 * v; }
+    };
+}
+
+TEST_CASE(attach_returns_handles_and_dedups)
+{
+    basic_delegates<int> d;
+    auto a = d.attach(&first);
+    auto again = d.attach(&first);
+    CHECK(a);
+    CHECK(a == again);
+    CHECK(d.size() == 1);
+
+    counter_t counter;
+    auto m = d.attach(&counter_t::add, &counter);
+    CHECK(m == d.attach(&counter_t::add, &counter));
+    CHECK(!(m == d.attach(&counter_t::twice, &counter)));
+    CHECK(d.size() == 3);
+}
+
+TEST_CASE(detach_by_handle_keeps_order)
+{
+    trace.clear();
+    basic_delegates<int> d;
+    d.attach(&first);
+    auto b = d.attach(&second);
+    d.attach(&third);
+
+    d.detach(b);
+    CHECK(!d.connected(b));
+    d(1);
+    CHECK(trace == "a1c1");
+
+    // a stale handle is ignored, even once its slot is reused
+    d.detach(b);
+    auto reused = d.attach(&second);
+    d.detach(b);
+    CHECK(d.connected(reused));
+    trace.clear();
+    d(2);
+    CHECK(trace == "a2c2b2");
+}
+
+TEST_CASE(detach_by_value)
+{
+    basic_delegates<int> d;
+    counter_t counter;
+    d.attach(&first);
+    d.attach(&counter_t::add, &counter);
+    d.detach(&counter_t::add, &counter);
+    d.detach(&first);
+    CHECK(d.size() == 0);
+
+    // many removals compact the list without losing the survivors
+    std::vector<counter_t> counters(100);
+    std::vector<connection_t> handles;
+    for (auto& c : counters)
+        handles.push_back(d.attach(&counter_t::add, &c));
+    for (size_t i = 0; i < handles.size(); i += 2)
+        d.detach(handles[i]);
+    d(1);
+    for (size_t i = 0; i < counters.size(); i++)
+        CHECK(counters[i].total == (i % 2 ? 1 : 0));
+    CHECK(d.size() == 50);
+}
+
+namespace
+{
+    basic_delegates<int>* reentrant = nullptr;
+    connection_t victim;
+
+    void attach_third(int) { reentrant->attach(&third); }
+    void detach_victim(int v) { trace += "d" + std::to_string(v); reentrant->detach(victim); }
+    void clear_all(int) { reentrant->clear(); }
+}
+
+TEST_CASE(modify_while_forwarding)
+{
+    basic_delegates<int> d;
+    reentrant = &d;
+
+    // attached during a call: first called on the next one
+    trace.clear();
+    d.attach(&attach_third);
+    d(1);
+    CHECK(trace == "");
+    d(2);
+    CHECK(trace == "c2");
+
+    // detached during a call: not called later in the same pass
+    d.clear();
+    trace.clear();
+    d.attach(&detach_victim);
+    victim = d.attach(&second);
+    d(3);
+    CHECK(trace == "d3");
+    CHECK(d.size() == 1);
+
+    // cleared from inside a handler
+    d.clear();
+    trace.clear();
+    d.attach(&clear_all);
+    d.attach(&first);
+    d(4);
+    CHECK(trace == "");
+    CHECK(d.size() == 0);
+    reentrant = nullptr;
+}
+
+TEST_CASE(functors_are_detached_by_connection)
+{
+    basic_delegates<int> d;
+    std::string label = "heap allocated label, too long for the inline buffer";
+    auto log = [label](int v) { trace += label.substr(0, 1) + std::to_string(v); };
+
+    // copies of a functor are distinct handlers
+    auto a = d.attach(log);
+    auto b = d.attach(log);
+    CHECK(!(a == b));
+    CHECK(d.size() == 2);
+
+    trace.clear();
+    d(1);
+    CHECK(trace == "h1h1");
+
+    d.detach(a);
+    d.detach(b);
+    CHECK(d.size() == 0);
+
+    // a prebuilt callback is still found by value
+    auto cb = basic_delegates<int>::callback_t(&first);
+    auto c = d.attach(cb);
+    CHECK(d.attach(cb) == c);
+    d.detach(cb);
+    CHECK(d.size() == 0);
+}
+
+namespace
+{
+    std::vector<int> order;
+
+    struct ranked_t
+    {
+        int rank = 0;
+        void on(int) { order.push_back(rank); }
+    };
+}
+
+TEST_CASE(priorities_order_handlers)
+{
+    basic_delegates<int> d;
+    trace.clear();
+    d.attach(&first);
+    d.attach(priority_t(5), &second);
+    d.attach(priority_t(-1), &third);
+    d(1);
+    CHECK(trace == "b1a1c1");
+
+    // many prioritized attaches, some detached before the list is next walked
+    std::vector<ranked_t> ranked(1000);
+    std::vector<connection_t> handles;
+    basic_delegates<int> many;
+    for (size_t i = 0; i < ranked.size(); i++)
+    {
+        ranked[i].rank = int(i % 7);
+        handles.push_back(many.attach(priority_t(ranked[i].rank), &ranked_t::on, &ranked[i]));
+    }
+    for (size_t i = 0; i < handles.size(); i += 3)
+        many.detach(handles[i]);
+    for (size_t i = 0; i < handles.size(); i += 3)
+        many.detach(handles[i + 1 < handles.size() ? i + 1 : i]);
+
+    order.clear();
+    many(0);
+    CHECK(order.size() == many.size());
+    CHECK(std::is_sorted(order.begin(), order.end(), [](int a, int b) { return a > b; }));
+
+    // equal priorities keep attach order, whenever they were attached
+    trace.clear();
+    basic_delegates<int> ties;
+    ties.attach(priority_t(1), &first);
+    ties.attach(&third);
+    ties.attach(priority_t(1), &second);
+    ties(2);
+    CHECK(trace == "a2b2c2");
+}
+
+namespace
+{
+    basic_delegates<int>* self_owner = nullptr;
+    connection_t self_connection;
+}
+
+TEST_CASE(self_detaching_functor_keeps_its_captures)
+{
+    // small enough to live inside the callback, not in a shared heap block
+    basic_delegates<int> d;
+    self_owner = &d;
+    auto value = std::make_shared<int>(7);
+    int seen = 0;
+    self_connection = d.attach([value, &seen](int) { self_owner->detach(self_connection); seen = *value; });
+    std::weak_ptr<int> watch = value;
+    value.reset();
+
+    d(1);
+    CHECK(seen == 7);
+    CHECK(d.size() == 0);
+    CHECK(watch.expired());
+
+    // same with clear()
+    value = std::make_shared<int>(8);
+    d.attach([value, &seen](int) { self_owner->clear(); seen = *value; });
+    watch = value;
+    value.reset();
+    d(2);
+    CHECK(seen == 8);
+    CHECK(watch.expired());
+    self_owner = nullptr;
+}
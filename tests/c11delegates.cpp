@@ -0,0 +1,253 @@
+#include "test.hpp"
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "c11delegates.hpp"
+
+namespace
+{
+    int total = 0;
+    void add_one(int v) { total += v + 1; }
+
+    struct target_t
+    {
+        int value = 0;
+        void add(int v) { value += v; }
+    };
+
+    typedef delegate<void(int)> delegate_t;
+    typedef std::hash<delegate_t> hash_t;
+}
+
+TEST_CASE(delegate_compares_pointers_by_value)
+{
+    delegate_t a(&add_one), b(&add_one);
+    CHECK(a == b);
+    CHECK(hash_t()(a) == hash_t()(b));
+
+    target_t target, other;
+    auto m = delegate_t::from(&target, &target_t::add);
+    CHECK(m == delegate_t::from(&target, &target_t::add));
+    CHECK(hash_t()(m) == hash_t()(delegate_t::from(&target, &target_t::add)));
+    CHECK(m != delegate_t::from(&other, &target_t::add));
+    CHECK(m != a);
+
+    m(3);
+    CHECK(target.value == 3);
+}
+
+TEST_CASE(delegate_functors_equal_their_copies)
+{
+    std::string label = "a label long enough to live on the heap";
+    auto small = [label](int v) { total += int(label.size()) + v; };
+    auto big = [label, pad = std::vector<int>(4)](int v) { total += int(label.size() + pad.size()) + v; };
+    std::function<void(int)> wide = small;
+    auto shared = std::make_shared<int>(1);
+    auto inline_functor = [shared](int v) { total += *shared + v; };
+
+    for (auto make : { std::function<delegate_t()>([&] { return delegate_t(inline_functor); }),
+                       std::function<delegate_t()>([&] { return delegate_t([&](int v) { total += v; }); }),
+                       std::function<delegate_t()>([&] { return delegate_t(small); }),
+                       std::function<delegate_t()>([&] { return delegate_t(big); }),
+                       std::function<delegate_t()>([&] { return delegate_t(wide); }) })
+    {
+        auto a = make();
+        auto b = make();
+        CHECK(a != b);
+
+        // copy-assigned over a buffer that held another functor
+        delegate_t c(&add_one);
+        c = delegate_t([](int) {});
+        c = a;
+        CHECK(c == a);
+        CHECK(hash_t()(c) == hash_t()(a));
+
+        delegate_t moved(std::move(b));
+        CHECK(moved != a);
+        CHECK(!b);
+    }
+
+    // a heap block is not reused for a functor of another type
+    delegate_t d(big);
+    d = [values = std::vector<int>(2, 1)](int v) { total += values[0] + v; };
+    total = 0;
+    d(1);
+    CHECK(total == 2);
+}
+
+TEST_CASE(delegate_holds_move_only_functors)
+{
+    // kept in the shared heap block, which copies of the delegate share
+    delegate<int()> d([p = std::make_unique<int>(3)] { return *p; });
+    CHECK(d() == 3);
+    auto copy = d;
+    CHECK(copy() == 3);
+    CHECK(copy == d);
+
+    // taken over by a unique_delegate once no other copy holds the block
+    copy = delegate<int()>();
+    unique_delegate<int()> u(std::move(d));
+    CHECK(u() == 3);
+
+    // a block still shared cannot be copied
+    delegate<int()> shared([p = std::make_unique<int>(4)] { return *p; });
+    auto other = shared;
+    bool thrown = false;
+    try { unique_delegate<int()> v(shared); }
+    catch (const std::logic_error&) { thrown = true; }
+    CHECK(thrown);
+    CHECK(other() == 4);
+}
+
+TEST_CASE(delegate_size_is_bounded)
+{
+    // object, stub and manager pointers, the shared block, the size and serial fields and the buffer
+    CHECK(sizeof(delegate_t) <= 6 * sizeof(void*) + 8 + YAGLIB_DELEGATE_BUFFER_SIZE);
+}
+
+namespace
+{
+    struct tracked_t
+    {
+        static int copies;
+        static int alive;
+        int pad[8] = {};    // too big for the inline buffer
+
+        tracked_t() { ++alive; }
+        tracked_t(const tracked_t&) { ++copies; ++alive; }
+        tracked_t(tracked_t&&) noexcept { ++alive; }
+        ~tracked_t() { --alive; }
+        void operator()(int v) const { total += v + pad[0]; }
+    };
+
+    int tracked_t::copies = 0;
+    int tracked_t::alive = 0;
+}
+
+TEST_CASE(unique_delegate_takes_the_callable_over)
+{
+    typedef unique_delegate<void(int)> unique_t;
+    total = 0;
+
+    // functions and bound methods are adopted without a box
+    unique_t f{ delegate_t(&add_one) };
+    f(1);
+    target_t target;
+    unique_t m(delegate_t::from(&target, &target_t::add));
+    m(2);
+    CHECK(total == 2 && target.value == 2);
+
+    {
+        // an unshared heap functor is moved out of its block, a shared one copied
+        delegate_t alone{ tracked_t() };
+        tracked_t::copies = 0;
+        unique_t moved(std::move(alone));
+        CHECK(tracked_t::copies == 0);
+
+        delegate_t shared{ tracked_t() };
+        delegate_t copy = shared;
+        unique_t copied(shared);
+        CHECK(tracked_t::copies == 1);
+        copied(1);
+        copy(1);
+        moved(1);
+        CHECK(total == 5);
+    }
+    CHECK(tracked_t::alive == 0);
+
+    // inline functors are moved into the buffer
+    std::string label = "label";
+    unique_t u(delegate_t([label](int v) { total += int(label.size()) + v; }));
+    u(0);
+    CHECK(total == 10);
+}
+
+namespace
+{
+    typedef delegate_ref<int(int)> visitor_t;
+    static_assert(std::is_trivially_copyable<visitor_t>::value, "delegate_ref must be trivially copyable");
+    static_assert(sizeof(visitor_t) == 2 * sizeof(void*), "delegate_ref must be two words");
+
+    int twice(int v) { return 2 * v; }
+
+    struct scaler_t
+    {
+        int factor = 3;
+        int scale(int v) const { return factor * v; }
+    };
+
+    int visit(visitor_t visitor, int v) { return visitor(v); }
+}
+
+TEST_CASE(delegate_ref_calls_without_owning)
+{
+    CHECK(!visitor_t());
+    CHECK(visit(&twice, 4) == 8);
+
+    int offset = 5;
+    CHECK(visit([&](int v) { return v + offset; }, 1) == 6);
+
+    scaler_t scaler;
+    CHECK(visit(visitor_t::from<scaler_t, &scaler_t::scale>(&scaler), 2) == 6);
+
+    // delegates are referenced through their target, which must outlive the ref
+    delegate<int(int)> owned([offset](int v) { return v - offset; });
+    visitor_t ref(owned);
+    CHECK(ref(10) == 5);
+    unique_delegate<int(int)> unique(&twice);
+    CHECK(visit(unique, 7) == 14);
+}
+
+namespace
+{
+    struct counting_allocator : delegate_allocator
+    {
+        int blocks = 0;
+        void* allocate(std::size_t size) override { ++blocks; return delegate_allocator::heap().allocate(size); }
+        void deallocate(void* p, std::size_t size) noexcept override { --blocks; delegate_allocator::heap().deallocate(p, size); }
+    };
+}
+
+TEST_CASE(delegate_allocators_serve_heap_functors)
+{
+    counting_allocator counting;
+    tracked_t big;
+    {
+        delegate_allocator_scope scope(counting);
+        delegate_t d(big);
+        CHECK(counting.blocks > 0);
+
+        // blocks remember their allocator, whatever is current when they are freed
+        delegate_allocator_scope inner(delegate_allocator::heap());
+        d = delegate_t(&add_one);
+    }
+    CHECK(counting.blocks == 0);
+
+    // inline functors never reach the allocator
+    {
+        delegate_allocator_scope scope(counting);
+        delegate_t d(&add_one);
+        CHECK(counting.blocks == 0);
+    }
+
+    delegate_pool_allocator pool;
+    {
+        delegate_allocator_scope scope(pool);
+        std::vector<delegate_t> many(100, delegate_t(big));
+        for (auto& d : many)
+            d = delegate_t(tracked_t());
+    }
+
+    delegate_arena_allocator arena(1024);
+    {
+        delegate_allocator_scope scope(arena);
+        std::vector<delegate_t> frame;
+        for (int i = 0; i < 50; i++)
+            frame.emplace_back(big);
+        CHECK(arena.live() > 0);
+    }
+    CHECK(arena.live() == 0);
+    arena.release();
+}
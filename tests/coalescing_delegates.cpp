@@ -0,0 +1,143 @@
+#include "test.hpp"
+#include <string>
+#include "coalescing_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    enum class tile_t { grass, water, rock, MAX };
+}
+
+template<> struct creaky::option_traits<tile_t>
+{
+    static constexpr std::size_t count = size_t(tile_t::MAX);
+};
+
+namespace
+{
+    std::string trace;
+
+    void on_value(int v) { trace += std::to_string(v) + " "; }
+
+    template<typename option_t>
+    void on_keyed(int v) { trace += std::to_string(v) + " "; }
+
+    keyed_coalescing_delegates<tile_t, int>* nested = nullptr;
+    void flush_again(int v)
+    {
+        trace += "n" + std::to_string(v) + " ";
+        (*nested)(tile_t::rock, v + 1);
+        CHECK(!nested->flush());
+    }
+
+    coalescing_delegates<int>* plain = nullptr;
+    void plain_flush_again(int v)
+    {
+        trace += "p" + std::to_string(v) + " ";
+        if (v < 3)
+            (*plain)(v + 1);
+        CHECK(!plain->flush());
+    }
+}
+
+static_assert(!std::is_convertible<coalescing_delegates<int>*, basic_delegates<int>*>::value,
+    "coalescing_delegates must not be usable as a basic_delegates");
+static_assert(!std::is_convertible<keyed_coalescing_delegates<int, int>*, mapped_delegates<int, int>*>::value,
+    "keyed_coalescing_delegates must not be usable as a mapped_delegates");
+
+TEST_CASE(coalescing_keeps_the_last_call)
+{
+    coalescing_delegates<int> d;
+    d.attach(&on_value);
+    trace.clear();
+    d(1);
+    d(2);
+    d(3);
+    CHECK(d.flush());
+    CHECK(!d.flush());
+    CHECK(trace == "3 ");
+
+    d.merge_with([](std::tuple<int>& waiting, int v) { std::get<0>(waiting) += v; });
+    trace.clear();
+    d(1);
+    d(2);
+    d.flush();
+    CHECK(trace == "3 ");
+    CHECK(d.stats().emitted == 5 && d.stats().dropped == 3 && d.stats().dispatched == 2);
+}
+
+template<typename option_t>
+static void check_keyed(option_t a, option_t b)
+{
+    keyed_coalescing_delegates<option_t, int> d;
+    d.attach(a, &on_keyed<option_t>);
+    d.attach(b, &on_keyed<option_t>);
+    for (int round = 0; round < 2; round++)
+    {
+        trace.clear();
+        d(b, 1);
+        d(a, 2);
+        d(b, 3);
+        CHECK(d.pending() == 2);
+        CHECK(d.flush());
+        CHECK(trace == "3 2 ");
+        CHECK(d.pending() == 0);
+    }
+}
+
+TEST_CASE(keyed_coalescing_per_option_storage)
+{
+    check_keyed<tile_t>(tile_t::grass, tile_t::water);
+    check_keyed<int>(7, 1 << 20);
+    check_keyed<std::string>("a", "b");
+
+    // enough options to grow the position table, hit in reverse order
+    keyed_coalescing_delegates<int, int> d;
+    int sum = 0, last = -1;
+    bool ordered = true;
+    for (int i = 0; i < 100; i++)
+        d.attach(i * 37, [&sum, &last, &ordered](int v) { ordered = ordered && v < last; last = v; sum += v; });
+    for (int round = 0; round < 2; round++)
+        for (int i = 99; i >= 0; i--)
+            d(i * 37, i + round * 1000);
+    CHECK(d.pending() == 100);
+    last = 1 << 30;
+    d.flush();
+    CHECK(ordered && sum == 100 * 1000 + 99 * 100 / 2);
+}
+
+TEST_CASE(keyed_coalescing_nested_flush)
+{
+    keyed_coalescing_delegates<tile_t, int> d;
+    nested = &d;
+    d.attach(tile_t::water, &flush_again);
+    d.attach(tile_t::rock, &on_value);
+    trace.clear();
+    d(tile_t::water, 1);
+    d(tile_t::grass, 5);
+    CHECK(d.flush());
+    CHECK(trace == "n1 ");
+    CHECK(d.pending() == 1);
+
+    trace.clear();
+    CHECK(d.flush());
+    CHECK(trace == "2 ");
+    nested = nullptr;
+}
+
+TEST_CASE(coalescing_nested_flush)
+{
+    coalescing_delegates<int> d;
+    plain = &d;
+    d.attach(&plain_flush_again);
+    trace.clear();
+    d(1);
+    CHECK(d.flush());
+    CHECK(trace == "p1 ");
+    CHECK(d.pending());
+
+    CHECK(d.flush());
+    CHECK(trace == "p1 p2 ");
+    plain = nullptr;
+}
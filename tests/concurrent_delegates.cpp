@@ -0,0 +1,93 @@
+#include "test.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "concurrent_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::atomic<int> hits{ 0 };
+    void count(int v) { hits += v; }
+    void other(int) {}
+
+    struct listener_t
+    {
+        std::atomic<int> calls{ 0 };
+        void on(int) { ++calls; }
+    };
+}
+
+TEST_CASE(concurrent_emit_while_attaching)
+{
+    concurrent_delegates<int> d;
+    d.attach(&count);
+    CHECK(d.attach(&count) == d.attach(&count));
+    CHECK(d.size() == 1);
+
+    hits = 0;
+    std::atomic<bool> stop{ false };
+    std::vector<std::thread> emitters;
+    for (int i = 0; i < 4; i++)
+        emitters.emplace_back([&] { while (!stop) d(1); });
+
+    // writers churn other handlers; count stays attached throughout
+    std::vector<listener_t> listeners(10);
+    for (int round = 0; round < 3; round++)
+    {
+        std::vector<connection_t> handles;
+        for (auto& l : listeners)
+            handles.push_back(d.attach(&listener_t::on, &l));
+        for (auto& h : handles)
+            d.detach(h);
+    }
+    stop = true;
+    for (auto& t : emitters)
+        t.join();
+
+    CHECK(d.size() == 1);
+    auto before = hits.load();
+    d(1);
+    CHECK(hits == before + 1);
+    d.attach(&other);
+    d.detach(&count);
+    d(1);
+    CHECK(hits == before + 1);
+}
+
+TEST_CASE(concurrent_mapped_routes_by_option)
+{
+    concurrent_mapped_delegates<int, int> d;
+    d.attach(1, &count);
+    auto h = d.attach(2, &count);
+    hits = 0;
+    d(1, 1);
+    d(2, 10);
+    d(3, 100);
+    CHECK(hits == 11);
+    d.detach(2, h);
+    d.notify_all(1000);
+    CHECK(hits == 1011);
+}
+
+TEST_CASE(concurrent_writes_keep_functor_state)
+{
+    // later snapshots share the functor instead of copying it
+    concurrent_delegates<int> d;
+    int seen = 0;
+    d.attach([&seen, n = 0](int) mutable { seen = ++n; });
+    d(0);
+    d.attach(&other);
+    d(0);
+    d.detach(&other);
+    d(0);
+    CHECK(seen == 3);
+
+    concurrent_mapped_delegates<int, int> m;
+    m.attach(1, [&seen, n = 0](int) mutable { seen = ++n; });
+    m(1, 0);
+    m.attach(2, &other);
+    m.notify_all(0);
+    CHECK(seen == 2);
+}
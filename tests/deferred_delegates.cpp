@@ -0,0 +1,82 @@
+#include "test.hpp"
+#include <memory>
+#include <string>
+#include <type_traits>
+#include "deferred_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::string trace;
+    void on_event(int v, bool flag) { trace += std::to_string(v) + (flag ? "+" : "-"); }
+
+    int batch_total = 0;
+    int batch_flags = 0;
+    void on_batch(arg_span<int> values, arg_span<stored_bool> flags)
+    {
+        for (auto v : values)
+            batch_total += v;
+        for (bool f : flags)
+            batch_flags += f;
+    }
+}
+
+// flush() runs the batch; calling the container never forwards through the base
+static_assert(!std::is_convertible<deferred_delegates<int>*, basic_delegates<int>*>::value,
+    "deferred_delegates must not be usable as a basic_delegates");
+
+TEST_CASE(deferred_flushes_batches)
+{
+    deferred_delegates<int, bool> d;
+    d.attach(&on_event);
+    d.attach_batch(&on_batch);
+
+    trace.clear();
+    d(1, true);
+    d(2, false);
+    d(3, true);
+    CHECK(trace == "");
+    CHECK(d.pending() == 3);
+
+    d.flush();
+    CHECK(trace == "1+2-3+");
+    CHECK(batch_total == 6);
+    CHECK(batch_flags == 2);
+    CHECK(d.pending() == 0);
+
+    // dispatch() skips the queue and the batch handlers
+    trace.clear();
+    d.dispatch(4, false);
+    CHECK(trace == "4-");
+    CHECK(batch_total == 6);
+
+    d.detach(&on_event);
+    d(5, true);
+    d.discard();
+    d.flush();
+    CHECK(d.size() == 0);
+    CHECK(batch_total == 6);
+}
+
+namespace
+{
+    deferred_delegates<int>* self_owner = nullptr;
+    connection_t self_connection;
+}
+
+TEST_CASE(deferred_self_detach_keeps_captures)
+{
+    deferred_delegates<int> d;
+    self_owner = &d;
+    auto value = std::make_shared<int>(7);
+    int total = 0;
+    self_connection = d.attach([value, &total](int v) { self_owner->detach(self_connection); total += *value + v; });
+    value.reset();
+    d(1);
+    d(2);
+    d.flush();
+    CHECK(total == 8);
+    CHECK(d.size() == 0);
+    self_owner = nullptr;
+}
@@ -0,0 +1,64 @@
+#include "test.hpp"
+#include "delegates.hpp"
+
+namespace
+{
+    struct payload_t
+    {
+        static int copies;
+        int value = 0;
+
+        payload_t() = default;
+        payload_t(const payload_t& other) : value(other.value) { ++copies; }
+        payload_t& operator=(const payload_t& other) { value = other.value; ++copies; return *this; }
+    };
+
+    int payload_t::copies = 0;
+
+    struct cheap_t
+    {
+        int value = 0;
+    };
+
+    int seen = 0;
+    void read_a(const payload_t& p) { seen += p.value; }
+    void read_b(const payload_t& p) { seen += 2 * p.value; }
+    void read_c(const payload_t& p, int n) { seen += n * p.value; }
+}
+
+template<>
+struct creaky::argument_traits<payload_t>
+{
+    static constexpr bool by_ref = true;
+};
+
+static_assert(std::is_same<creaky::details::forward_t<payload_t>, const payload_t&>::value, "payload_t is forwarded by reference");
+static_assert(std::is_same<creaky::details::forward_t<cheap_t>, cheap_t>::value, "small trivial types stay by value");
+
+using namespace creaky;
+
+TEST_CASE(by_ref_arguments_are_never_copied)
+{
+    payload_t payload;
+    payload.value = 3;
+    payload_t::copies = 0;
+    seen = 0;
+
+    basic_delegates<payload_t> d;
+    d.attach(&read_a);
+    d.attach(&read_b);
+    d(payload);
+    CHECK(seen == 9);
+
+    mapped_delegates<int, payload_t, int> m;
+    m.attach(1, &read_c);
+    m(1, payload, 2);
+    m.notify_all(payload, 1);
+    CHECK(seen == 18);
+
+    parametric_delegates<int, payload_t> p;
+    p.attach(0, &read_a);
+    p(payload);
+    CHECK(seen == 21);
+    CHECK(payload_t::copies == 0);
+}
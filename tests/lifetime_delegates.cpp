@@ -0,0 +1,97 @@
+#include "test.hpp"
+#include <memory>
+#include <vector>
+#include "delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    struct node_t : trackable
+    {
+        int calls = 0;
+        void on(int v) { calls += v; }
+    };
+}
+
+TEST_CASE(tracked_handlers_go_away_with_their_object)
+{
+    basic_delegates<int> d;
+    node_t keeper;
+    auto doomed = std::make_unique<node_t>();
+    d.attach_tracked(&node_t::on, &keeper);
+    auto c = d.attach_tracked<&node_t::on>(doomed.get());
+    d(1);
+    CHECK(doomed->calls == 1 && d.size() == 2);
+
+    // destroying the object is all it takes; the next call drops the handler
+    doomed.reset();
+    CHECK(d.connected(c));
+    d(1);
+    CHECK(!d.connected(c));
+    CHECK(d.size() == 1 && keeper.calls == 2);
+
+    // an object reusing the same memory is a new object
+    doomed = std::make_unique<node_t>();
+    d(1);
+    CHECK(doomed->calls == 0);
+
+    // copies are tracked on their own
+    {
+        node_t copy = keeper;
+        copy.calls = 0;
+        d.attach_tracked(&node_t::on, &copy);
+        d(1);
+        CHECK(copy.calls == 1 && keeper.calls == 4);
+    }
+    d(1);
+    CHECK(d.size() == 1 && keeper.calls == 5);
+}
+
+namespace
+{
+    int once_calls = 0;
+    int n_calls = 0;
+    basic_delegates<int>* host = nullptr;
+
+    void once(int) { ++once_calls; }
+    void thrice(int) { ++n_calls; }
+    void attach_once_again(int) { host->attach_once(&once); }
+}
+
+TEST_CASE(limited_handlers_expire_after_their_calls)
+{
+    basic_delegates<int> d;
+    once_calls = n_calls = 0;
+    auto o = d.attach_once(&once);
+    d.attach_n(3, &thrice);
+    CHECK(d.size() == 2);
+
+    for (int i = 0; i < 5; i++)
+        d(i);
+    CHECK(once_calls == 1 && n_calls == 3);
+    CHECK(!d.connected(o));
+    CHECK(d.size() == 0);
+
+    // attached from inside a call: first called on the next one, once
+    host = &d;
+    d.attach(&attach_once_again);
+    d(0);
+    CHECK(once_calls == 1);
+    d(0);
+    CHECK(once_calls == 2);
+
+    // the second attach_once() found the first one still attached, which then expired
+    CHECK(d.size() == 1);
+    host = nullptr;
+
+    // many one-shot listeners are all swept by the call that spends them
+    basic_delegates<int> burst;
+    std::vector<node_t> nodes(500);
+    for (auto& n : nodes)
+        burst.attach_once(&node_t::on, &n);
+    burst(1);
+    burst(1);
+    CHECK(burst.size() == 0);
+    CHECK(nodes.front().calls == 1 && nodes.back().calls == 1);
+}
@@ -0,0 +1,18 @@
+#include "test.hpp"
+
+int main()
+{
+    int failed = 0;
+    for (auto& test : creaky_tests::registry())
+    {
+        auto before = creaky_tests::failures();
+        test.run();
+        if (creaky_tests::failures() != before)
+        {
+            std::printf("FAIL %s\n", test.name);
+            ++failed;
+        }
+    }
+    std::printf("%d/%d test cases passed\n", int(creaky_tests::registry().size()) - failed, int(creaky_tests::registry().size()));
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+#include "test.hpp"
+#include <algorithm>
+#include <string>
+#include "delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    enum class flat_event { spawn, hit, die, count };
+    enum class sparse_event { low = 3, high = 100000 };
+
+    std::string trace;
+    void on_a(int v) { trace += "a" + std::to_string(v); }
+    void on_b(int v) { trace += "b" + std::to_string(v); }
+}
+
+template<> struct creaky::option_traits<flat_event>
+{
+    static constexpr std::size_t count = std::size_t(flat_event::count);
+};
+
+namespace
+{
+    template<typename option_t>
+    void check_routing(option_t x, option_t y)
+    {
+        mapped_delegates<option_t, int> m;
+        trace.clear();
+        m.attach(x, &on_a);
+        auto b = m.attach(y, &on_b);
+        m(x, 1);
+        m(y, 2);
+        CHECK(trace == "a1b2");
+        CHECK(m.size() == 2);
+
+        m.detach(y, b);
+        trace.clear();
+        m(y, 3);
+        m(x, 4);
+        CHECK(trace == "a4");
+
+        m.clear();
+        m(x, 5);
+        CHECK(trace == "a4");
+        CHECK(m.size() == 0);
+    }
+
+    mapped_delegates<sparse_event, int>* clearing = nullptr;
+    void clear_from_handler(int) { clearing->clear(); }
+}
+
+TEST_CASE(mapped_storages_route_by_option)
+{
+    static_assert(std::is_same<details::select_option_storage<flat_event, int>::type,
+        details::flat_option_storage<flat_event, int>>::value, "flat storage expected");
+    static_assert(std::is_same<details::select_option_storage<sparse_event, int>::type,
+        details::hashed_option_storage<sparse_event, int>>::value, "hashed storage expected");
+    static_assert(std::is_same<details::select_option_storage<std::string, int>::type,
+        details::tree_option_storage<std::string, int>>::value, "tree storage expected");
+
+    check_routing(flat_event::hit, flat_event::die);
+    check_routing(sparse_event::low, sparse_event::high);
+    check_routing(std::string("x"), std::string("y"));
+
+    // many sparse keys through the hashed storage
+    mapped_delegates<int, int> m;
+    for (int i = 0; i < 1000; i++)
+        m.attach(i * 7919, &on_a);
+    trace.clear();
+    m(7919 * 999, 1);
+    m(1, 1);
+    CHECK(trace == "a1");
+}
+
+TEST_CASE(mapped_clear_while_dispatching)
+{
+    mapped_delegates<sparse_event, int> m;
+    clearing = &m;
+    m.attach(sparse_event::low, &clear_from_handler);
+    m.attach(sparse_event::low, &on_a);
+    m.attach(sparse_event::high, &on_b);
+    trace.clear();
+    m(sparse_event::low, 1);
+    CHECK(trace == "");
+    CHECK(m.size() == 0);
+    m(sparse_event::high, 2);
+    CHECK(trace == "");
+    clearing = nullptr;
+}
+
+namespace
+{
+    mapped_delegates<int, int>* broadcasting = nullptr;
+    int late_calls = 0;
+    void late(int) { ++late_calls; }
+    void attach_then_broadcast(int v)
+    {
+        if (v != 0)
+            return;
+        broadcasting->attach(1, &late);
+        broadcasting->notify_all(1);
+    }
+}
+
+TEST_CASE(mapped_notify_all)
+{
+    mapped_delegates<int, int> m;
+    m.attach(1, &on_a);
+    m.attach(2, &on_b);
+    m.attach(3, &on_a);
+    // options are visited in storage order
+    trace.clear();
+    m.notify_all(1);
+    CHECK(trace.size() == 6 && std::count(trace.begin(), trace.end(), 'a') == 2);
+
+    m.set_notify_unique(true);
+    trace.clear();
+    m.notify_all(2);
+    CHECK(trace.size() == 4 && std::count(trace.begin(), trace.end(), 'a') == 1);
+
+    m.detach(2, &on_b);
+    trace.clear();
+    m.notify_all(3);
+    CHECK(trace == "a3");
+}
+
+TEST_CASE(mapped_notify_all_sees_handlers_attached_mid_call)
+{
+    // a handler of option 1 attaches under 1, then broadcasts while its
+    // own sub-delegates are still being called
+    mapped_delegates<int, int> m;
+    broadcasting = &m;
+    m.attach(1, &attach_then_broadcast);
+    m(1, 0);
+    late_calls = 0;
+    m.notify_all(1);
+    CHECK(late_calls == 1);
+    m(1, 1);
+    CHECK(late_calls == 2);
+    broadcasting = nullptr;
+}
+
+TEST_CASE(mapped_notify_all_calls_the_attached_functor)
+{
+    // operator() and notify_all() both reach the one functor that was attached
+    mapped_delegates<int, int> m;
+    trace.clear();
+    m.attach(1, [n = 0](int) mutable { trace += std::to_string(++n); });
+    m(1, 0);
+    m.notify_all(0);
+    m(1, 0);
+    m.notify_all(0);
+    CHECK(trace == "1234");
+}
@@ -0,0 +1,61 @@
+// YAGLIB_DELEGATES_ERASE_EMPTY changes mapped_delegates::erase_empty(), so
+// this file only instantiates mapped_delegates with its own option types
+#define YAGLIB_DELEGATES_ERASE_EMPTY
+#include "test.hpp"
+#include <string>
+#include "delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    enum class erase_event { a = 1, b = 50000 };
+
+    struct erase_key_t
+    {
+        int value;
+        bool operator<(const erase_key_t& rhs) const { return value < rhs.value; }
+    };
+
+    int calls = 0;
+    mapped_delegates<erase_event, int>* hashed = nullptr;
+    mapped_delegates<erase_key_t, int>* tree = nullptr;
+    void detach_self_hashed(int);
+    void detach_self_tree(int);
+
+    void detach_self_hashed(int) { ++calls; hashed->detach(erase_event::a, &detach_self_hashed); }
+    void detach_self_tree(int) { ++calls; tree->detach(erase_key_t{ 1 }, &detach_self_tree); }
+    void reattach_hashed(int) { ++calls; hashed->detach(erase_event::a, &reattach_hashed); hashed->attach(erase_event::a, &detach_self_hashed); }
+}
+
+TEST_CASE(mapped_erase_empty_while_dispatching)
+{
+    mapped_delegates<erase_event, int> m;
+    hashed = &m;
+    m.attach(erase_event::a, &detach_self_hashed);
+    m.attach(erase_event::b, &detach_self_hashed);
+    m(erase_event::a, 0);
+    CHECK(calls == 1);
+    CHECK(m.size() == 1);
+
+    // emptied then refilled during the same call: the option survives
+    m.attach(erase_event::a, &reattach_hashed);
+    m(erase_event::a, 0);
+    CHECK(m.size() == 2);
+    m(erase_event::a, 0);
+    CHECK(calls == 3);
+    CHECK(m.size() == 1);
+
+    // detached from a broadcast
+    m.attach(erase_event::a, &detach_self_hashed);
+    m.notify_all(0);
+    CHECK(m.size() == 1);
+
+    mapped_delegates<erase_key_t, int> t;
+    tree = &t;
+    t.attach(erase_key_t{ 1 }, &detach_self_tree);
+    t(erase_key_t{ 1 }, 0);
+    CHECK(t.size() == 0);
+    hashed = nullptr;
+    tree = nullptr;
+}
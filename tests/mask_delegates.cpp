@@ -0,0 +1,141 @@
+#include "test.hpp"
+#include <memory>
+#include <string>
+#include "delegates.hpp"
+#include "indexed_delegates.hpp"
+#include "mask_delegates.hpp"
+#include "parallel_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::string trace;
+    void on_a(int v) { trace += "a" + std::to_string(v); }
+    void on_b(int v) { trace += "b" + std::to_string(v); }
+
+    struct counter_t
+    {
+        int calls = 0;
+        void add(int) { ++calls; }
+    };
+
+    struct tracked_counter_t : trackable
+    {
+        int calls = 0;
+        void add(int) { ++calls; }
+    };
+
+    struct any_delegates : static_parametric_delegates<any_delegates, int, int>
+    {
+        bool can_forward(const int&, int) { return true; }
+    };
+
+    // the attach/detach rules every handler_store container shares
+    template<typename D, typename E>
+    void check_store(D& d, E extra)
+    {
+        counter_t counter;
+        auto a = d.attach(extra, &on_a);
+        CHECK(d.attach(extra, &on_a) == a);
+        auto m = d.attach(extra, &counter_t::add, &counter);
+        CHECK(d.attach(extra, &counter_t::add, &counter) == m);
+
+        auto cb = typename D::callback_t(&on_b);
+        auto b = d.attach(extra, cb);
+        CHECK(d.attach(extra, cb) == b);
+
+        auto f = d.attach(extra, [](int) {});
+        CHECK(!(f == d.attach(extra, [](int) {})));
+        CHECK(d.size() == 5);
+
+        d.detach(&on_a);
+        d.detach(&counter_t::add, &counter);
+        d.detach(cb);
+        d.detach(f);
+        CHECK(!d.connected(a) && !d.connected(f));
+        CHECK(d.size() == 1);
+        d.clear();
+        CHECK(d.size() == 0);
+    }
+}
+
+TEST_CASE(mask_delegates_match_bits)
+{
+    mask_delegates<std::uint64_t, int> d;
+    d.attach(std::uint64_t(0b011), &on_a);
+    d.attach(std::uint64_t(0b100), &on_b);
+    {
+        tracked_counter_t counter;
+        d.attach_tracked(std::uint64_t(0b110), &tracked_counter_t::add, &counter);
+        trace.clear();
+        d(std::uint64_t(0b100), 1);
+        d(std::uint64_t(0b010), 2);
+        CHECK(trace == "b1a2");
+        CHECK(counter.calls == 2);
+    }
+
+    // the tracked handler went with its object
+    trace.clear();
+    d(std::uint64_t(0b110), 3);
+    CHECK(trace == "a3b3");
+    CHECK(d.size() == 2);
+
+    // already attached: keeps its mask
+    auto a = d.attach(std::uint64_t(0b100), &on_a);
+    CHECK(d.mask_of(a) == 0b011);
+}
+
+TEST_CASE(handler_store_containers_dedup_alike)
+{
+    any_delegates s;
+    check_store(s, 1);
+    mask_delegates<std::uint64_t, int> m;
+    check_store(m, std::uint64_t(1));
+    bit_indexed_parametric_delegates<std::uint32_t, int> b;
+    check_store(b, std::uint32_t(1));
+    parallel_delegates<int> p;
+    check_store(p, affinity_t::caller);
+}
+
+namespace
+{
+    connection_t self_connection;
+    int self_seen = 0;
+
+    template<typename D>
+    D* self_target = nullptr;
+
+    // a handler whose only capture (small enough to live inside the callback)
+    // is read after it detached itself
+    template<typename D, typename E>
+    void check_self_detach(D& d, E extra)
+    {
+        self_target<D> = &d;
+        auto value = std::make_shared<int>(7);
+        self_connection = d.attach(extra, [value](int) { self_target<D>->detach(self_connection); self_seen = *value; });
+        value.reset();
+        self_seen = 0;
+        if constexpr (std::is_same<D, parallel_delegates<int>>::value)
+            d.emit_parallel(1).wait();
+        else if constexpr (std::is_base_of<static_parametric_delegates<any_delegates, int, int>, D>::value)
+            d(1);
+        else
+            d(extra, 1);
+        CHECK(self_seen == 7);
+        CHECK(d.size() == 0);
+        self_target<D> = nullptr;
+    }
+}
+
+TEST_CASE(handler_store_self_detach_keeps_captures)
+{
+    mask_delegates<std::uint64_t, int> m;
+    check_self_detach(m, std::uint64_t(1));
+    bit_indexed_parametric_delegates<std::uint32_t, int> b;
+    check_self_detach(b, std::uint32_t(1));
+    any_delegates s;
+    check_self_detach(s, 1);
+    parallel_delegates<int> p;
+    check_self_detach(p, affinity_t::caller);
+}
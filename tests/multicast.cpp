@@ -0,0 +1,118 @@
+#include "test.hpp"
+#include <limits>
+#include <vector>
+#include "c11delegates.hpp"
+
+namespace
+{
+    struct listener_t
+    {
+        int calls = 0;
+        void on(int v) { calls += v; }
+    };
+
+    typedef multicast<void(int)> event_t;
+    typedef delegate<void(int)> handler_t;
+
+    event_t* running = nullptr;
+    std::vector<listener_t>* others = nullptr;
+
+    void add_while_called(int)
+    {
+        running->add(handler_t::from(&(*others)[1], &listener_t::on));
+        running->remove(handler_t::from(&(*others)[0], &listener_t::on));
+    }
+}
+
+TEST_CASE(multicast_adds_once_and_removes)
+{
+    std::vector<listener_t> listeners(10000);
+    event_t event;
+    for (auto& l : listeners)
+        CHECK(event.add(handler_t::from(&l, &listener_t::on)));
+    CHECK(!event.add(handler_t::from(&listeners[42], &listener_t::on)));
+    CHECK(event.size() == listeners.size());
+
+    for (size_t i = 0; i < listeners.size(); i += 2)
+        CHECK(event.remove(handler_t::from(&listeners[i], &listener_t::on)));
+    CHECK(!event.contains(handler_t::from(&listeners[0], &listener_t::on)));
+    CHECK(event.contains(handler_t::from(&listeners[1], &listener_t::on)));
+
+    event(1);
+    int called = 0;
+    for (size_t i = 0; i < listeners.size(); i++)
+        called += listeners[i].calls == int(i % 2);
+    CHECK(called == int(listeners.size()));
+
+    // a functor is found again through its copies
+    int hits = 0;
+    handler_t lambda([&hits](int v) { hits += v; });
+    CHECK(event.add(lambda));
+    CHECK(!event.add(lambda));
+    event(2);
+    CHECK(hits == 2);
+    CHECK(event.remove(lambda));
+}
+
+TEST_CASE(multicast_changes_while_called)
+{
+    std::vector<listener_t> listeners(2);
+    others = &listeners;
+    event_t event;
+    running = &event;
+    event.add(&add_while_called);
+    event.add(handler_t::from(&listeners[0], &listener_t::on));
+
+    // removed during the call: skipped; added during the call: next time
+    event(1);
+    CHECK(listeners[0].calls == 0 && listeners[1].calls == 0);
+    event(1);
+    CHECK(listeners[1].calls == 1);
+    CHECK(event.size() == 2);
+    running = nullptr;
+}
+
+namespace
+{
+    int cost_a(int v) { return v + 3; }
+    int cost_b(int v) { return v + 1; }
+    int cost_c(int v) { return v + 2; }
+
+    int vetoes = 0;
+    bool allow(int) { ++vetoes; return true; }
+    bool forbid(int) { ++vetoes; return false; }
+
+    int found = 7;
+    int* find_none(int) { return nullptr; }
+    int* find_some(int) { return &found; }
+}
+
+TEST_CASE(multicast_folds_results)
+{
+    multicast<int(int), combine_sum<int>> sum;
+    sum.add(&cost_a);
+    sum.add(&cost_b);
+    sum.add(&cost_c);
+    CHECK(sum(10) == 36);
+    CHECK(sum.fold<combine_min<int>>(10) == 11);
+    CHECK(sum.fold<combine_max<int>>(10) == 13);
+
+    // folding over no handler gives the identity of the fold
+    multicast<int(int), combine_min<int>> none;
+    CHECK(none(1) == std::numeric_limits<int>::max());
+
+    // all stops at the first veto
+    multicast<bool(int), combine_all> all;
+    all.add(&forbid);
+    all.add(&allow);
+    vetoes = 0;
+    CHECK(!all(0));
+    CHECK(vetoes == 1);
+    CHECK(all.fold<combine_any>(0));
+
+    multicast<int*(int), combine_first<int*>> first;
+    first.add(&find_none);
+    CHECK(first(0) == nullptr);
+    first.add(&find_some);
+    CHECK(first(0) == &found);
+}
@@ -0,0 +1,77 @@
+#include "test.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "parallel_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::atomic<int> total{ 0 };
+    std::thread::id caller_thread;
+    bool ran_on_caller = false;
+
+    void add(int v) { total += v; }
+    void on_caller(int) { ran_on_caller = std::this_thread::get_id() == caller_thread; }
+    void fail(int) { throw std::runtime_error("handler failed"); }
+}
+
+TEST_CASE(parallel_runs_every_handler)
+{
+    // a pool of its own, passed by reference to the public task_pool type
+    task_pool pool(2);
+    parallel_delegates<int> d(pool);
+    std::atomic<int> counted{ 0 };
+    d.attach(&add);
+    d.attach([&counted](int v) { counted += v; });
+    d.attach(affinity_t::caller, &on_caller);
+
+    total = 0;
+    caller_thread = std::this_thread::get_id();
+    for (int i = 0; i < 200; i++)
+        d.emit_parallel(1).wait();
+    CHECK(total == 200 && counted == 200);
+    CHECK(ran_on_caller);
+
+    d(2);
+    CHECK(total == 202);
+
+    d.detach(&add);
+    d.emit_parallel(1).wait();
+    CHECK(total == 202 && counted == 203);
+}
+
+TEST_CASE(parallel_rethrows_from_wait)
+{
+    parallel_delegates<int> d;
+    d.attach(&fail);
+    auto token = d.emit_parallel(0);
+    bool thrown = false;
+    try { token.wait(); }
+    catch (const std::runtime_error&) { thrown = true; }
+    CHECK(thrown);
+    CHECK(!token.joinable());
+}
+
+TEST_CASE(task_pool_workers_sleep_between_bursts)
+{
+    task_pool pool(3);
+    std::atomic<int> done{ 0 };
+    auto run = [](void* context, size_t) { ++*static_cast<std::atomic<int>*>(context); };
+
+    // submitted from outside the pool, with the workers asleep each time
+    for (int burst = 0; burst < 50; burst++)
+    {
+        task_pool::task_t tasks[4];
+        for (auto& task : tasks)
+            task = task_pool::task_t{ run, &done, 0 };
+        pool.submit(tasks, 4);
+        while (done < (burst + 1) * 4)
+            std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    CHECK(done == 200);
+    CHECK(!pool.run_one());
+}
@@ -0,0 +1,145 @@
+#include "test.hpp"
+#include <string>
+#include <vector>
+#include "delegates.hpp"
+#include "indexed_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::string trace;
+    void on_a(int v) { trace += "a" + std::to_string(v); }
+    void on_b(int v) { trace += "b" + std::to_string(v); }
+    void on_c(int v) { trace += "c" + std::to_string(v); }
+
+    struct counter_t
+    {
+        int calls = 0;
+        void add(int) { ++calls; }
+    };
+
+    // forwards to handlers whose extra value divides the argument
+    struct divisor_delegates : static_parametric_delegates<divisor_delegates, int, int>
+    {
+        bool can_forward(const int& extra, int v) { return v % extra == 0; }
+    };
+
+    // same, with its own batch test
+    struct batched_delegates : static_parametric_delegates<batched_delegates, int, int>
+    {
+        int batches = 0;
+        bool can_forward(const int& extra, int v) { return v % extra == 0; }
+        void can_forward_batch(const int* extras, size_t count, bool* result, int v)
+        {
+            ++batches;
+            for (size_t i = 0; i < count; i++)
+                result[i] = v % extras[i] == 0;
+        }
+    };
+}
+
+TEST_CASE(static_parametric_filters_by_extra)
+{
+    divisor_delegates d;
+    d.attach(2, &on_a);
+    d.attach(3, &on_b);
+    auto c = d.attach(5, &on_c);
+    CHECK(d.attach(7, &on_c) == c);
+
+    trace.clear();
+    d(6);
+    d(10);
+    d(7);
+    CHECK(trace == "a6b6a10c10");
+
+    d.detach(c);
+    trace.clear();
+    d(30);
+    CHECK(trace == "a30b30");
+
+    // 101 handlers: two batches of 64
+    batched_delegates b;
+    std::vector<counter_t> counters(100);
+    for (int i = 0; i < 100; i++)
+        b.attach(i + 1, &counter_t::add, &counters[i]);
+    b.attach(50, &on_a);
+    trace.clear();
+    b(100);
+    CHECK(trace == "a100");
+    CHECK(b.batches == 2);
+    CHECK(counters[24].calls == 1 && counters[25].calls == 0);
+}
+
+TEST_CASE(indexed_parametric_routes_by_extra)
+{
+    indexed_parametric_delegates<int, int> d;
+    counter_t counter;
+    auto a = d.attach(1, &on_a);
+    auto m = d.attach(2, &counter_t::add, &counter);
+
+    // a duplicate keeps its bucket and hands back the existing connection
+    CHECK(d.attach(3, &on_a) == a);
+    CHECK(d.attach(3, &counter_t::add, &counter) == m);
+    CHECK(d.size() == 2);
+
+    trace.clear();
+    d(1, 4);
+    d(3, 5);
+    CHECK(trace == "a4");
+
+    // detached through its connection, the handler can be attached elsewhere
+    d.detach(2, m);
+    CHECK(d.size() == 1);
+    auto moved = d.attach(3, &counter_t::add, &counter);
+    CHECK(moved);
+    d(3, 6);
+    d(2, 6);
+    CHECK(counter.calls == 1);
+
+    d.detach(&counter_t::add, &counter);
+    d.detach(&on_a);
+    CHECK(d.size() == 0);
+}
+
+namespace
+{
+    indexed_parametric_delegates<int, int>* indexed = nullptr;
+    void clear_indexed(int v) { trace += "x" + std::to_string(v); indexed->clear(); }
+}
+
+TEST_CASE(indexed_parametric_clear_and_connections)
+{
+    indexed_parametric_delegates<int, int> d;
+    indexed = &d;
+
+    // cleared from a handler of the bucket being called
+    d.attach(7, &clear_indexed);
+    d.attach(7, &on_a);
+    trace.clear();
+    d(7, 1);
+    CHECK(trace == "x1");
+    CHECK(d.size() == 0);
+    d(7, 2);
+    CHECK(trace == "x1");
+
+    // first handlers of two buckets: distinct connections, and a wrong extra value is ignored
+    auto a = d.attach(1, &on_a);
+    auto b = d.attach(2, &on_b);
+    CHECK(!(a == b));
+    d.detach(2, a);
+    CHECK(d.connected(a) && d.size() == 2);
+    d.detach(1, a);
+    CHECK(!d.connected(a) && d.connected(b));
+
+    // functors too, and a stale connection is ignored once its handle is reused
+    auto f = d.attach(1, [](int v) { trace += "f" + std::to_string(v); });
+    d.detach(1, f);
+    auto g = d.attach(1, [](int v) { trace += "g" + std::to_string(v); });
+    d.detach(1, f);
+    trace.clear();
+    d(1, 3);
+    CHECK(trace == "g3");
+    CHECK(d.connected(g));
+    indexed = nullptr;
+}
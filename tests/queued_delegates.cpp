@@ -0,0 +1,99 @@
+#include "test.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+#include "queued_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    // no default constructor
+    struct unit_t
+    {
+        int id;
+        explicit unit_t(int id) : id(id) {}
+    };
+
+    std::string trace;
+    queued_delegates<unit_t, int>* queue = nullptr;
+
+    void on_move(unit_t unit, int x) { trace += std::to_string(unit.id) + ":" + std::to_string(x) + " "; }
+    void drain_again(unit_t, int) { queue->post(unit_t(9), 9); CHECK(queue->drain() == 0); }
+}
+
+static_assert(!std::is_convertible<queued_delegates<int>*, basic_delegates<int>*>::value,
+    "queued_delegates must not be usable as a basic_delegates");
+
+TEST_CASE(queued_drains_in_post_order)
+{
+    queued_delegates<unit_t, int> q(4);
+    q.attach(&on_move);
+    CHECK(q.capacity() == 4);
+
+    trace.clear();
+    CHECK(q.post(unit_t(1), 10));
+    CHECK(q.post(unit_t(2), 20));
+    CHECK(q.post(unit_t(1), 11));
+    CHECK(q.drain() == 3);
+    CHECK(trace == "1:10 2:20 1:11 ");
+
+    // only the last event of each key
+    q.coalesce_by([](const unit_t& unit, const int&) { return std::uint64_t(unit.id); });
+    trace.clear();
+    q.post(unit_t(1), 10);
+    q.post(unit_t(2), 20);
+    q.post(unit_t(1), 12);
+    CHECK(q.drain() == 2);
+    CHECK(trace == "2:20 1:12 ");
+    q.coalesce_off();
+
+    // full: refused and counted
+    for (int i = 0; i < 5; i++)
+        q.post(unit_t(i), i);
+    auto stats = q.stats();
+    CHECK(stats.dropped == 1 && stats.coalesced == 1 && stats.drained == 5 && stats.high_water == 4);
+    q.discard();
+    CHECK(q.pending() == 0);
+
+    // a drain from a handler does nothing; what the handler posted waits
+    queue = &q;
+    q.attach(&drain_again);
+    q.post(unit_t(3), 3);
+    trace.clear();
+    CHECK(q.drain() == 1);
+    CHECK(trace == "3:3 ");
+    q.detach(&drain_again);
+    trace.clear();
+    CHECK(q.drain() == 1);
+    CHECK(trace == "9:9 ");
+    queue = nullptr;
+}
+
+TEST_CASE(queued_accepts_posts_from_threads)
+{
+    queued_delegates<int> q(1 << 12);
+    int sum = 0;
+    q.attach([&sum](int v) { sum += v; });
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; t++)
+        producers.emplace_back([&q] {
+            for (int i = 1; i <= 500; i++)
+                while (!q.post(i)) {}
+        });
+    // depths are read while both ends move, they must still stay in range
+    size_t drained = 0;
+    bool bounded = true;
+    while (drained < 2000)
+    {
+        drained += q.drain();
+        bounded = bounded && q.pending() <= q.capacity() && q.stats().high_water <= q.capacity();
+    }
+    for (auto& p : producers)
+        p.join();
+    CHECK(bounded);
+    CHECK(sum == 4 * 500 * 501 / 2);
+    CHECK(q.stats().drained == 2000);
+    CHECK(q.stats().high_water <= q.capacity());
+}
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef __CREAKY_TESTS_T_H__
+#define __CREAKY_TESTS_T_H__
+
+#include <cstdio>
+#include <vector>
+
+/**
+ * minimal test registry: TEST_CASE(name) { ... CHECK(expr); ... } in any
+ * source of the target, main.cpp runs them all.
+ */
+namespace creaky_tests
+{
+    struct test_case_t
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    inline std::vector<test_case_t>& registry()
+    {
+        static std::vector<test_case_t> cases;
+        return cases;
+    }
+
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    struct registrar
+    {
+        registrar(const char* name, void (*run)()) { registry().push_back(test_case_t{ name, run }); }
+    };
+
+    inline void fail(const char* file, int line, const char* expression)
+    {
+        std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+        ++failures();
+    }
+
+} /// namespace creaky_tests
+
+#define TEST_CASE(name) \
+    static void name(); \
+    static creaky_tests::registrar name##_registrar(#name, &name); \
+    static void name()
+
+#define CHECK(expression) \
+    do { if (!(expression)) creaky_tests::fail(__FILE__, __LINE__, #expression); } while (0)
+
+#endif /// __CREAKY_TESTS_T_H__
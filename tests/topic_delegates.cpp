@@ -0,0 +1,83 @@
+#include "test.hpp"
+#include <string>
+#include <vector>
+#include "topic_delegates.hpp"
+
+using namespace creaky;
+
+namespace
+{
+    std::string trace;
+
+    void on_damage(int v) { trace += "d" + std::to_string(v) + " "; }
+    void on_unit(int v) { trace += "u" + std::to_string(v) + " "; }
+}
+
+TEST_CASE(topics_match_patterns)
+{
+    topic_delegates<int> d;
+    d.attach("unit.*.damaged", &on_damage);
+    d.attach("unit.#", &on_unit);
+    CHECK(d.size() == 2);
+
+    trace.clear();
+    d("unit.42.damaged", 1);
+    d("unit.42", 2);
+    d("building.42.damaged", 3);
+    CHECK(trace == "d1 u1 u2 ");
+
+    d.detach("unit.#", &on_unit);
+    trace.clear();
+    d("unit.42.damaged", 4);
+    CHECK(trace == "d4 ");
+}
+
+TEST_CASE(topic_handles_survive_many_topics)
+{
+    topic_delegates<int> d;
+    int total = 0;
+    d.attach("cell.*.*", [&total](int v) { total += v; });
+
+    // enough topics to rehash the lookup table several times; looked up
+    // again through buffers that no longer exist once topic() returns
+    std::vector<topic_delegates<int>::topic_t> ids;
+    for (int i = 0; i < 1000; i++)
+        ids.push_back(d.topic("cell." + std::to_string(i % 40) + "." + std::to_string(i)));
+    bool same = true;
+    for (int i = 0; i < 1000; i++)
+        same = same && d.topic(std::string("cell.") + std::to_string(i % 40) + "." + std::to_string(i)) == ids[i];
+    CHECK(same);
+
+    for (auto id : ids)
+        d(id, 1);
+    CHECK(total == 1000);
+
+    // segments are interned by view too: a pattern spelled from a temporary matches
+    d.attach(std::string("cell.7.#"), &on_unit);
+    trace.clear();
+    d(std::string("cell.7.") + "47", 5);
+    CHECK(trace == "u5 ");
+    CHECK(total == 1005);
+}
+
+TEST_CASE(topic_patterns_run_in_first_attach_order)
+{
+    // "a.#" creates the trie node of "a" before "a" itself is attached
+    topic_delegates<int> d;
+    auto early = d.topic("a");
+    d.attach("a.#", &on_unit);
+    d.attach("a", &on_damage);
+
+    trace.clear();
+    d(early, 1);
+    d("a", 2);
+    d("a.b", 3);
+    CHECK(trace == "u1 d1 u2 d2 u3 ");
+
+    // detaching keeps the rank of the pattern
+    d.detach("a.#", &on_unit);
+    d.attach("a.#", &on_unit);
+    trace.clear();
+    d(early, 4);
+    CHECK(trace == "u4 d4 ");
+}